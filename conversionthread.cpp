@@ -5,16 +5,27 @@
  **/
 
 #include "conversionthread.h"
+#include "utils/encoderworker.h"
+#include "utils/imageinfo.h"
+#ifdef HAVE_LIBJXL
+#include "utils/sharedparallelrunner.h"
+#endif
 
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QProcess>
 #include <QMapIterator>
 #include <QRegularExpression>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <climits>
 
-#define TICKS 1
-#define TICKS_MULTIPLIER 10
-#define POLL_RATE_MS 100
+#define CONTROL_INTERVAL_MS 1000
+#define MEMORY_POLL_MS 200
 
 ConversionThread::ConversionThread(QObject *parent)
     : QThread(parent)
@@ -26,9 +37,7 @@ ConversionThread::ConversionThread(QObject *parent)
 
 ConversionThread::~ConversionThread()
 {
-    mutex.lock();
-    m_abort = true;
-    mutex.unlock();
+    stopProcess();
 
     wait();
 }
@@ -83,6 +92,62 @@ void ConversionThread::initArgs(const QMap<QString, QString> &args)
             m_processNonAscii = true;
         }
 
+        if (mit.key() == "-e") {
+            m_effort = mit.value().toInt();
+        }
+
+        if (mit.key() == "ramBudget") {
+            m_memoryBudget = mit.value().toLongLong() * 1024 * 1024;
+        }
+
+        if (mit.key() == "inProcess") {
+            m_inProcess = true;
+            m_isDecode = (mit.value() == "decode");
+        }
+
+        if (mit.key() == "workerHost" && mit.value() == "1") {
+            m_useWorkerHost = true;
+        }
+
+        if (mit.key() == "autoThreads" && mit.value() == "1") {
+            m_autoConcurrency = true;
+        }
+
+        if (mit.key() == "coreBudget") {
+            m_coreBudget.setCores(mit.value().toInt());
+            m_useNumThreads = true;
+        }
+
+        if (mit.key() == "dedup" && mit.value() == "1") {
+            m_useDedup = true;
+        }
+
+        if (mit.key() == "resumeManifest" && mit.value() == "1") {
+            m_useManifest = true;
+        }
+
+        if (mit.key() == "outputCacheDir") {
+            m_cacheDir = mit.value();
+        }
+
+        if (mit.key() == "outputCacheLimit") {
+            // MiB
+            m_cacheLimit = mit.value().toLongLong() * 1024 * 1024;
+        }
+
+        if (mit.key() == "encodeHash") {
+            m_encodeHash = mit.value();
+        }
+
+        if (mit.key() == "runReport") {
+            m_useReport = true;
+            m_reportFormat = (mit.value() == "csv") ? RunReport::Format::Csv : RunReport::Format::Jsonl;
+        }
+
+        if (mit.key() == "encoderVersion") {
+            m_encoderVersion = mit.value();
+        }
+
         if (mit.key() == "outSuffix") {
             m_outSuffix = mit.value();
         }
@@ -106,7 +171,26 @@ void ConversionThread::initArgs(const QMap<QString, QString> &args)
         m_encOpts.insert(mit.key(), mit.value());
     }
 
-    startTimer(TICKS * TICKS_MULTIPLIER);
+    // user supplied thread count wins over the core budget
+    for (const QString &ar : qAsConst(m_customArgs)) {
+        if (ar.startsWith("--num_threads")) {
+            m_useNumThreads = false;
+        }
+    }
+
+    // anything the in-process encoder can't honor goes through cjxl as before
+    if (m_inProcess) {
+        // worker processes can be killed, encodes inside this one can't
+        if (m_globalTimeout > 0 && !m_useWorkerHost) {
+            m_inProcessFallback = QString("in-process encodes can't be timed out");
+        } else if (m_isDecode) {
+            m_decoder.setOptions(m_encOpts, &m_inProcessFallback);
+        } else {
+            m_encoder.setOptions(m_encOpts, &m_inProcessFallback);
+        }
+        m_inProcess = m_inProcessFallback.isEmpty();
+    }
+    m_useWorkerHost = m_useWorkerHost && m_inProcess;
 }
 
 int ConversionThread::processFiles(const QString &cjxlbin,
@@ -115,14 +199,7 @@ int ConversionThread::processFiles(const QString &cjxlbin,
                                    const QMap<QString, QString> &args)
 {
     m_cjxlbin = cjxlbin;
-    m_finBatch.clear();
-
-    int numfiles = 0;
-
-    for (const QString &fi : fin) {
-        m_finBatch.append(fi);
-        numfiles++;
-    }
+    m_queue.reset(new JobQueue(fin));
 
     m_fout = fout;
 
@@ -132,24 +209,17 @@ int ConversionThread::processFiles(const QString &cjxlbin,
 
     initArgs(args);
 
-    return numfiles;
+    return m_queue->size();
 }
 
 int ConversionThread::processFilesWithList(const QString &cjxlbin,
-                                           const QStringList &fin,
+                                           const QSharedPointer<JobQueue> &queue,
                                            const QString &fout,
                                            const QMap<QString, QString> &args,
                                            const bool useList)
 {
     m_cjxlbin = cjxlbin;
-    m_finBatch.clear();
-
-    int numfiles = 0;
-
-    for (const QString &fi : fin) {
-        m_finBatch.append(fi);
-        numfiles++;
-    }
+    m_queue = queue;
 
     m_fout = fout;
 
@@ -159,7 +229,22 @@ int ConversionThread::processFilesWithList(const QString &cjxlbin,
 
     initArgs(args);
 
-    return numfiles;
+    return m_queue ? m_queue->size() : 0;
+}
+
+void ConversionThread::setOutputDirs(const QSharedPointer<OutputDirCache> &outDirs)
+{
+    m_outDirs = outDirs;
+}
+
+LogRing *ConversionThread::logRing()
+{
+    return &m_logRing;
+}
+
+int ConversionThread::progress() const
+{
+    return m_progress.loadRelaxed();
 }
 
 int ConversionThread::processFiles(const QString &cjxlbin,
@@ -168,9 +253,8 @@ int ConversionThread::processFiles(const QString &cjxlbin,
                                     const QMap<QString, QString> &args)
 {
     m_cjxlbin = cjxlbin;
-    m_finBatch.clear();
 
-    int numfiles = 0;
+    QStringList finBatch;
 
     while (dit.hasNext()) {
         /*
@@ -180,23 +264,25 @@ int ConversionThread::processFiles(const QString &cjxlbin,
          */
         const QString ditto = dit.next();
         if (!ditto.contains(fout)) {
-            m_finBatch.append(ditto);
-            numfiles++;
+            finBatch.append(ditto);
         }
     }
 
+    m_queue.reset(new JobQueue(finBatch));
+
     m_fout = fout;
 
     resetValues();
 
     initArgs(args);
 
-    return numfiles;
+    return m_queue->size();
 }
 
 void ConversionThread::resetValues()
 {
-    m_abort = false;
+    m_abort.storeRelaxed(0);
+    m_progress.storeRelaxed(0);
     m_useFileList = false;
     m_isJpegTran = false;
     m_isOverwrite = false;
@@ -208,8 +294,27 @@ void ConversionThread::resetValues()
     m_isMultithread = false;
     m_keepDateTime = false;
     m_processNonAscii = false;
+    m_useNumThreads = false;
+    m_autoConcurrency = false;
+    m_inProcess = false;
+    m_isDecode = false;
+    m_useWorkerHost = false;
+    m_useManifest = false;
+    m_useDedup = false;
+    m_resumeFromManifest = false;
+    m_useReport = false;
+    m_reportFormat = RunReport::Format::Jsonl;
+    m_effort = 7;
+    m_memoryBudget = 0;
+    m_memoryInUse = 0;
 
     m_customArgs.clear();
+    m_inProcessFallback.clear();
+    m_encodeHash.clear();
+    m_encoderVersion.clear();
+    m_cacheDir.clear();
+    m_cacheLimit = 0;
+    m_outDirs.reset();
     m_outSuffix.clear();
     m_tempFolderName.clear();
     m_tempFolderIn.clear();
@@ -220,7 +325,6 @@ void ConversionThread::resetValues()
     m_globalTimeout = 0;
     m_totalBytesInput = 0;
     m_totalBytesOutput = 0;
-    m_ticks = 0;
 }
 
 void ConversionThread::run()
@@ -228,12 +332,10 @@ void ConversionThread::run()
     /*
      * Process in a thread?! I must be running wild...
      *
-     * I can go away using QObject instead, but I kinda risking calling
-     * too many processEvents() when waiting the app to complete while still
-     * needing to interrupt the process anytime. So here it is...
+     * This thread only runs an event loop: every encoder is a QProcess owned
+     * by this thread, and its finished() signal hands the job slot straight
+     * to the next file instead of polling waitForFinished() all day long.
      */
-    QProcess cjxlBin;
-
     if (m_processNonAscii) {
         if (!QDir("./jxl-batch-temp").exists()) {
             QDir(".").mkpath("./jxl-batch-temp");
@@ -259,73 +361,473 @@ void ConversionThread::run()
 
     // emit sendProgress(0);
 
-    int sizeIter = 1;
-    const int batchSize = m_finBatch.size();
-    for (const QString &fin : qAsConst(m_finBatch)) {
-        if (m_abort) {
-            emit sendLogs(QString("Aborted\n"), errLogCol, LogCode::INFO);
-            m_ls->addFiles(fin, LogCode::ABORTED);
-            calculateStats();
-            return;
+    if (!m_queue) {
+        calculateStats();
+        return;
+    }
+
+    // results are recorded against the jobs, the summary reads them back from there
+    m_jobs = m_queue->table();
+    m_ls->setJobTable(m_jobs);
+
+    // the Input folder scan hands over its own, already filled in
+    if (!m_outDirs) {
+        QString inputBase;
+        if (!m_useFileList) {
+            const QFileInfo inFileFirst(m_fin);
+            inputBase = inFileFirst.isFile() ? inFileFirst.absolutePath() : inFileFirst.absoluteFilePath();
         }
+        m_outDirs.reset(new OutputDirCache(m_fout, inputBase));
+        m_outDirs->setSkipExisting(!m_isOverwrite);
+    }
 
-        const QFileInfo inFile(fin);
+    if (m_useManifest) {
+        if (m_manifest.open(m_fout, m_encodeHash, encoderName())) {
+            m_resumeFromManifest = m_manifest.hadEntries();
+        } else {
+            emit sendLogs(QString("Cannot write %1 to the output folder, this batch won't be resumable\n")
+                              .arg(QString(BatchManifest::fileName())),
+                          warnLogCol,
+                          LogCode::INFO);
+        }
+    }
 
-        const QDir outFUrl = [&]() {
-            if (m_useFileList) {
-                return QDir::cleanPath(m_fout);
-            }
+    if (m_useReport) {
+        if (m_report.open(m_fout, m_reportFormat, m_encodeHash, encoderName())) {
+            emit sendLogs(QString("Writing the per-file report to %1\n").arg(QDir::toNativeSeparators(m_report.filePath())),
+                          statLogCol,
+                          LogCode::INFO);
+        } else {
+            emit sendLogs(QString("Cannot write a report to the output folder, continuing without one\n"), warnLogCol, LogCode::INFO);
+        }
+    }
 
-            QString inFUrl;
-            inFUrl = m_fin;
+    // without a version to key on, a cached output could come from some other encoder
+    if (m_cacheLimit > 0 && !m_disableOutput && !encoderName().isEmpty()) {
+        if (!m_cache.open(m_cacheDir, m_cacheLimit)) {
+            emit sendLogs(QString("Cannot use the output cache at %1\n").arg(m_cacheDir), warnLogCol, LogCode::INFO);
+        }
+    }
 
-            QFileInfo inFileFirst(inFUrl);
+    if (m_useWorkerHost) {
+        m_ls->setEncoderBackend(QString("%1, worker processes").arg(LibJxlEncoder::version()));
+    } else if (m_inProcess) {
+        m_ls->setEncoderBackend(QString("%1, in-process").arg(LibJxlEncoder::version()));
+    } else {
+        if (!m_inProcessFallback.isEmpty()) {
+            emit sendLogs(QString("In-process encoder not used (%1), running %2 instead\n")
+                              .arg(m_inProcessFallback, QFileInfo(m_cjxlbin).fileName()),
+                          warnLogCol,
+                          LogCode::INFO);
+        }
+        m_ls->setEncoderBackend(QFileInfo(m_cjxlbin).fileName());
+    }
 
-            QDir inUrl;
-            if (inFileFirst.isFile()) {
-               inUrl.setPath(inFileFirst.absolutePath());
-            } else {
-               inUrl.setPath(inFileFirst.absoluteFilePath());
+    QObject loopCtx;
+
+    // one small launcher for the whole batch, forking that stays cheap
+    // while forking the GUI gets slower the more memory it holds
+    SpawnClient spawner;
+    if (SpawnClient::isSupported()) {
+        connect(&spawner, &SpawnClient::started, &loopCtx, [this](int id, qint64 pid) {
+            const int i = slotForSpawn(id);
+            if (i >= 0) {
+                m_slots[i].pid = pid;
+                addSpawnSample(m_slots[i].jobTimer.nsecsElapsed() / 1e6);
+            }
+        });
+        connect(&spawner,
+                &SpawnClient::finished,
+                &loopCtx,
+                [this](int id, int exitCode, bool crashed, const QByteArray &stdErr, const QByteArray &stdOut) {
+                    Q_UNUSED(crashed);
+                    const int i = slotForSpawn(id);
+                    if (i >= 0) {
+                        m_slots[i].exitCode = exitCode;
+                        m_slots[i].stdErr = stdErr;
+                        m_slots[i].stdOut = stdOut;
+                        jobFinished(i);
+                    }
+                });
+        connect(&spawner, &SpawnClient::failed, &loopCtx, [this](int id, const QString &message) {
+            const int i = slotForSpawn(id);
+            if (i >= 0) {
+                m_slots[i].failedToStart = true;
+                m_slots[i].spawnError = message;
+                jobFinished(i);
+            }
+        });
+        connect(&spawner, &SpawnClient::helperLost, &loopCtx, [this, &loopCtx]() {
+            // whatever it was running is gone with it, the rest go through QProcess
+            m_spawner = nullptr;
+            for (int i = 0; i < m_slots.size(); i++) {
+                if (m_slots[i].isRunning && m_slots[i].viaHelper) {
+                    m_slots[i].failedToStart = true;
+                    m_slots[i].spawnError = QString("Spawn helper exited");
+                    QMetaObject::invokeMethod(
+                        &loopCtx,
+                        [this, i]() {
+                            jobFinished(i);
+                        },
+                        Qt::QueuedConnection);
+                }
             }
+        });
 
-            const QString basePath = inUrl.absolutePath();
-            const QString extraDirName = QString(inFile.absolutePath()).remove(basePath);
+        if (spawner.start()) {
+            m_spawner = &spawner;
+        } else {
+            emit sendLogs(QString("Spawn helper failed to start, launching processes directly\n"), warnLogCol, LogCode::INFO);
+        }
+    }
 
-            return QDir::cleanPath(m_fout + extraDirName);
-        }();
-        if (!outFUrl.exists()) {
-            if (!outFUrl.mkpath(".") && !outFUrl.exists()) {
-                if (!m_isMultithread) {
-                    const QString head =
-                        QString("Processing image(s) %2/%3:\n%1")
-                            .arg(inFile.absoluteFilePath(), QString::number(sizeIter), QString::number(batchSize));
-                    emit sendLogs(head, Qt::white, LogCode::FILE_IN);
-                } else {
-                    const QString head =
-                        QString("Processing image(s):\n%1")
-                            .arg(inFile.absoluteFilePath());
-                    emit sendLogs(head, Qt::white, LogCode::FILE_IN);
+    QTimer deadlineTimer;
+    deadlineTimer.setSingleShot(true);
+    connect(&deadlineTimer, &QTimer::timeout, &loopCtx, [this]() {
+        checkDeadlines();
+    });
+    m_deadlineTimer = &deadlineTimer;
+
+    QTimer controlTimer;
+    if (m_autoConcurrency) {
+        connect(&controlTimer, &QTimer::timeout, &loopCtx, [this]() {
+            if (m_concurrency.update()) {
+                if (!m_isSilent) {
+                    emit sendLogs(QString("Auto threads: %1 process(es), last measured %2 MP/s\n")
+                                      .arg(QString::number(m_concurrency.jobs()),
+                                           QString::number(m_concurrency.lastThroughput())),
+                                  statLogCol,
+                                  LogCode::INFO);
                 }
-                emit sendLogs(QString("Failed to create subfolder at %1").arg(outFUrl.absolutePath()),
-                              errLogCol,
-                              LogCode::OUT_FOLDER_ERR);
-                emit sendLogs(QString("Skipping..."), errLogCol, LogCode::INFO);
+                applyJobLimit();
+            }
+        });
+        controlTimer.start(CONTROL_INTERVAL_MS);
+    }
 
-                m_ls->addFiles(inFile.absoluteFilePath(), LogCode::OUT_FOLDER_ERR);
+    QTimer memoryTimer;
+    if (m_memoryBudget > 0) {
+        connect(&memoryTimer, &QTimer::timeout, &loopCtx, [this]() {
+            pollMemory();
+        });
+        memoryTimer.start(MEMORY_POLL_MS);
+    }
+    m_memEstimator.reset(m_effort);
+    m_dedup.reset(m_jobs);
+    m_dedupWaiting.clear();
+    m_dedupDone.clear();
+    m_dedupRetry.clear();
+    m_spawnLatencyMs = 0.0;
+    m_spawnSamples = 0;
 
-                sizeIter++;
-                emit sendProgress(sizeIter);
+    mutex.lock();
+    m_loopCtx = &loopCtx;
+    m_concurrency.reset(m_maxJobs);
+    mutex.unlock();
 
-                continue;
+    // the folder scan may still be filling the queue, idle slots get woken up as it grows
+    m_wakeQueued.storeRelaxed(0);
+    m_queue->setNotifier([this]() {
+        queueChanged();
+    });
+
+    m_slots.clear();
+    applyJobLimit();
+
+    if (runningJobs() > 0 || hashingJobs() > 0 || (!m_abort.loadAcquire() && !m_queue->isDrained())) {
+        exec();
+    }
+
+    m_queue->setNotifier(nullptr);
+
+    mutex.lock();
+    m_loopCtx = nullptr;
+    mutex.unlock();
+
+    m_deadlineTimer = nullptr;
+    m_manifest.close();
+    m_cache.close();
+
+    // duplicates still waiting on an encode when the batch got aborted
+    for (const DedupSibling &sibling : qAsConst(m_dedupRetry)) {
+        recordResult(sibling.jobIndex, LogCode::ABORTED, -1, sibling.fout);
+    }
+    for (const QVector<DedupSibling> &siblings : qAsConst(m_dedupWaiting)) {
+        for (const DedupSibling &sibling : siblings) {
+            recordResult(sibling.jobIndex, LogCode::ABORTED, -1, sibling.fout);
+        }
+    }
+    m_dedupRetry.clear();
+    m_dedupWaiting.clear();
+    m_report.close();
+
+    if (m_spawnSamples > 0 && !m_isSilent) {
+        emit sendLogs(QString("Process start latency: %1 ms average over %2 process(es) %3, app peak RSS %4 MiB\n")
+                          .arg(QString::number(m_spawnLatencyMs / m_spawnSamples, 'f', 2),
+                               QString::number(m_spawnSamples),
+                               m_spawner ? QString("via spawn helper") : QString("via QProcess"),
+                               QString::number(MemoryEstimator::readPeakRss(QCoreApplication::applicationPid()) / (1024 * 1024))),
+                      statLogCol,
+                      LogCode::INFO);
+    }
+    m_spawner = nullptr;
+
+    stopWorkers();
+
+    for (const JobSlot &slot : qAsConst(m_slots)) {
+        m_ls->addWorkerBusyTime(slot.busyMs);
+    }
+    m_slots.clear();
+
+    calculateStats();
+}
+
+void ConversionThread::addJobSlot()
+{
+    const int i = m_slots.size();
+    m_slots.append(JobSlot());
+
+    JobSlot &slot = m_slots[i];
+
+    if (m_useWorkerHost) {
+        slot.worker = new QProcess(m_loopCtx);
+        // a job handed to a worker that's still starting goes out once it's up
+        connect(slot.worker, &QProcess::started, m_loopCtx, [this, i]() {
+            JobSlot &slot = m_slots[i];
+            if (!slot.workerJobLine.isEmpty()) {
+                slot.worker->write(slot.workerJobLine);
+                slot.workerJobLine.clear();
+            }
+        });
+        connect(slot.worker, &QProcess::readyReadStandardOutput, m_loopCtx, [this, i]() {
+            readWorkerReply(i);
+        });
+        connect(slot.worker,
+                QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+                m_loopCtx,
+                [this, i](int exitCode, QProcess::ExitStatus exitStatus) {
+                    Q_UNUSED(exitCode);
+                    Q_UNUSED(exitStatus);
+                    workerExited(i);
+                });
+        connect(slot.worker, &QProcess::errorOccurred, m_loopCtx, [this, i](QProcess::ProcessError error) {
+            m_slots[i].workerJobLine.clear();
+            if (error == QProcess::FailedToStart && m_slots[i].isRunning) {
+                m_slots[i].failedToStart = true;
+                QMetaObject::invokeMethod(
+                    m_loopCtx,
+                    [this, i]() {
+                        jobFinished(i);
+                    },
+                    Qt::QueuedConnection);
+            }
+        });
+    } else if (m_inProcess) {
+        slot.watcher = new QFutureWatcher<LibJxlResult>(m_loopCtx);
+        connect(slot.watcher, &QFutureWatcher<LibJxlResult>::finished, m_loopCtx, [this, i]() {
+            JobSlot &slot = m_slots[i];
+            // finished before it noticed the abort, the output is complete and counts as such
+            if (slot.isAborted && slot.watcher->result().success) {
+                slot.isAborted = false;
+            }
+            // the library passed on this one, the slot stays busy with the binary instead
+            if (slot.watcher->result().needsBinary && !m_abort.loadAcquire()) {
+                startCjxl(slot, slot.fin, slot.fout);
+                return;
+            }
+            jobFinished(i);
+        });
+    }
+
+    if (m_useDedup || m_cache.isOpen()) {
+        slot.hashWatcher = new QFutureWatcher<QVector<QByteArray>>(m_loopCtx);
+        connect(slot.hashWatcher, &QFutureWatcher<QVector<QByteArray>>::finished, m_loopCtx, [this, i]() {
+            finishHash(i);
+        });
+    }
+
+    slot.proc = new QProcess(m_loopCtx);
+
+    // each slot gets its own temp folders so concurrent jobs can't collide
+    if (!m_tempFolderIn.isEmpty() && QDir(m_tempFolderIn).mkpath(QString::number(i))) {
+        slot.tempFolderIn = QString("%1/%2").arg(m_tempFolderIn, QString::number(i));
+    }
+    if (!m_tempFolderOut.isEmpty() && QDir(m_tempFolderOut).mkpath(QString::number(i))) {
+        slot.tempFolderOut = QString("%1/%2").arg(m_tempFolderOut, QString::number(i));
+    }
+
+    connect(slot.proc, &QProcess::started, m_loopCtx, [this, i]() {
+        addSpawnSample(m_slots[i].jobTimer.nsecsElapsed() / 1e6);
+    });
+    connect(slot.proc,
+            QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            m_loopCtx,
+            [this, i](int exitCode, QProcess::ExitStatus exitStatus) {
+                Q_UNUSED(exitCode);
+                Q_UNUSED(exitStatus);
+                jobFinished(i);
+            });
+    connect(slot.proc, &QProcess::errorOccurred, m_loopCtx, [this, i](QProcess::ProcessError error) {
+        // finished() never comes for a process that didn't start at all,
+        // queue it so a run of failures doesn't recurse through start()
+        if (error == QProcess::FailedToStart) {
+            m_slots[i].failedToStart = true;
+            QMetaObject::invokeMethod(
+                m_loopCtx,
+                [this, i]() {
+                    jobFinished(i);
+                },
+                Qt::QueuedConnection);
+        }
+    });
+}
+
+void ConversionThread::applyJobLimit()
+{
+    mutex.lock();
+    const int maxJobs = m_maxJobs;
+    mutex.unlock();
+
+    if (m_autoConcurrency) {
+        m_concurrency.setMaxJobs(maxJobs);
+        m_jobLimit = m_concurrency.jobs();
+    } else {
+        m_jobLimit = maxJobs;
+    }
+
+    while (m_slots.size() < m_jobLimit) {
+        addJobSlot();
+    }
+    if (m_inProcess && !m_useWorkerHost && m_encodePool.maxThreadCount() < m_jobLimit) {
+        m_encodePool.setMaxThreadCount(m_jobLimit);
+    }
+#ifdef HAVE_LIBJXL
+    if (m_inProcess && !m_useWorkerHost) {
+        // every job's own thread works on its image too, the shared workers make up the rest of the cores
+        const int cores = m_useNumThreads ? m_coreBudget.cores() : QThread::idealThreadCount();
+        SharedParallelRunner::instance()->setWorkerCount(std::max(cores - m_jobLimit, 0));
+    }
+#endif
+
+    startIdleSlots();
+}
+
+void ConversionThread::startIdleSlots()
+{
+    // slots above the limit are retired once their current job is done
+    for (int i = 0; i < m_jobLimit && !m_abort.loadAcquire(); i++) {
+        if (!m_slots.at(i).isRunning && !m_slots.at(i).isPending && !m_slots.at(i).isHashing) {
+            startNextJob(i);
+        }
+    }
+    armDeadlineTimer();
+}
+
+void ConversionThread::queueChanged()
+{
+    // one wake-up in flight is enough, however many folders came in meanwhile
+    if (!m_wakeQueued.testAndSetRelaxed(0, 1)) {
+        return;
+    }
+
+    mutex.lock();
+    if (m_loopCtx) {
+        QMetaObject::invokeMethod(
+            m_loopCtx,
+            [this]() {
+                m_wakeQueued.storeRelaxed(0);
+                startIdleSlots();
+                quitIfDone();
+            },
+            Qt::QueuedConnection);
+    }
+    mutex.unlock();
+}
+
+void ConversionThread::quitIfDone()
+{
+    if (runningJobs() == 0 && hashingJobs() == 0 && (m_abort.loadAcquire() || (m_queue->isDrained() && m_dedupRetry.isEmpty()))) {
+        quit();
+    }
+}
+
+bool ConversionThread::startNextJob(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+
+    // copies of an image whose encode failed get a go of their own, first in line
+    if (!m_dedupRetry.isEmpty() && !m_abort.loadAcquire()) {
+        const DedupSibling sibling = m_dedupRetry.takeFirst();
+        slot.busyTimer.start();
+        return startFile(slotIndex, sibling.jobIndex, sibling.fin, sibling.fout);
+    }
+
+    QString fin;
+    int jobIndex = 0;
+    const int batchSize = m_queue->size();
+    while (m_queue->takeNext(fin, jobIndex)) {
+        // only the time spent on a file counts, the rest is idling on an empty queue
+        slot.busyTimer.start();
+        const int sizeIter = jobIndex + 1;
+
+        if (m_abort.loadAcquire()) {
+            emit sendLogs(QString("Aborted\n"), errLogCol, LogCode::INFO);
+            recordResult(jobIndex, LogCode::ABORTED);
+            slot.busyMs += slot.busyTimer.elapsed();
+            return false;
+        }
+
+        const QFileInfo inFile(fin);
+
+        // the scan has usually created the folder already, this is just a lookup then
+        const QString outFUrl = m_jobs->outputDirFor(jobIndex, *m_outDirs);
+        if (!m_outDirs->ensure(outFUrl)) {
+            if (!m_isMultithread) {
+                const QString head =
+                    QString("Processing image(s) %2/%3:\n%1")
+                        .arg(inFile.absoluteFilePath(), QString::number(sizeIter), QString::number(batchSize));
+                emit sendLogs(head, Qt::white, LogCode::FILE_IN);
+            } else {
+                const QString head =
+                    QString("Processing image(s):\n%1")
+                        .arg(inFile.absoluteFilePath());
+                emit sendLogs(head, Qt::white, LogCode::FILE_IN);
             }
+            emit sendLogs(QString("Failed to create subfolder at %1").arg(outFUrl),
+                          errLogCol,
+                          LogCode::OUT_FOLDER_ERR);
+            emit sendLogs(QString("Skipping..."), errLogCol, LogCode::INFO);
+
+            recordResult(jobIndex, LogCode::OUT_FOLDER_ERR);
+
+            m_progress.fetchAndAddRelaxed(1);
+            slot.busyMs += slot.busyTimer.elapsed();
+
+            continue;
         }
 
         const QString outFName = inFile.completeBaseName()
             + (m_outSuffix.isEmpty() ? QString() : QString("%1").arg(m_outSuffix)) + m_extension;
-        const QString outFPath = QDir::cleanPath(outFUrl.path() + QDir::separator() + outFName);
+        const QString outFPath = QDir::cleanPath(outFUrl + QDir::separator() + outFName);
 
-        const QFileInfo outFile(outFPath);
-        if (!m_isOverwrite && outFile.exists()) {
+        // answered from one listing of the output folder, not a stat per file; the name is
+        // claimed first, so two inputs with the same output name never both encode into it
+        const bool alreadyDone = [&]() {
+            if (m_isOverwrite) {
+                return false;
+            }
+            if (m_outDirs->claimFile(outFUrl, outFName)) {
+                return false;
+            }
+            // with a manifest from an earlier run, an output it recorded but that's out of date,
+            // or that a killed run only got as far as starting, is redone; one it doesn't know
+            // is left alone like any other existing file
+            if (!m_resumeFromManifest || !m_manifest.isRecorded(inFile, outFPath) || m_manifest.isUpToDate(inFile, outFPath)) {
+                return true;
+            }
+            return !m_outDirs->claimExisting(outFUrl, outFName);
+        }();
+        if (alreadyDone) {
             if (!m_isSilent) {
                 if (!m_isMultithread) {
                     const QString head =
@@ -339,16 +841,19 @@ void ConversionThread::run()
                     emit sendLogs(head, Qt::white, LogCode::FILE_IN);
                 }
 
-                emit sendLogs(QString("Skipped, output file already exists\n"), warnLogCol, LogCode::SKIPPED);
+                emit sendLogs(m_resumeFromManifest && m_manifest.isUpToDate(inFile, outFPath) ? QString("Skipped, unchanged since the last run\n")
+                                                   : QString("Skipped, output file already exists\n"),
+                              warnLogCol,
+                              LogCode::SKIPPED);
             } else {
                 emit sendLogs(QString(), Qt::white, LogCode::FILE_IN);
                 emit sendLogs(QString(), warnLogCol, LogCode::SKIPPED);
             }
 
-            m_ls->addFiles(inFile.absoluteFilePath(), LogCode::SKIPPED_ALREADY_EXIST);
+            recordResult(jobIndex, LogCode::SKIPPED_ALREADY_EXIST, -1, outFPath);
 
-            sizeIter++;
-            emit sendProgress(sizeIter);
+            m_progress.fetchAndAddRelaxed(1);
+            slot.busyMs += slot.busyTimer.elapsed();
 
             continue;
         } else {
@@ -360,22 +865,501 @@ void ConversionThread::run()
             }
         }
 
-        if (!runCjxl(cjxlBin, inFile, outFPath)) {
-            calculateStats();
-            return;
+        // on record before anything writes the output, whichever way it ends up made
+        m_manifest.markStarted(inFile, outFPath);
+
+        bool dedupHash = false;
+        if (m_useDedup) {
+            const int primary = m_dedup.match(inFile, jobIndex);
+            if (primary >= 0 && takeDuplicate({inFile, outFPath, jobIndex}, primary)) {
+                slot.busyMs += slot.busyTimer.elapsed();
+                continue;
+            }
+            // read for the cache anyway, it might as well be kept for later same-sized inputs
+            dedupHash = primary < 0 && (m_cache.isOpen() || m_dedup.needsHash(inFile, jobIndex));
+        }
+
+        // the content is read on the pool, the slot carries on in finishHash() once it's in,
+        // the one hash serves both the duplicate check and the cache key
+        if (dedupHash || m_cache.isOpen()) {
+            startHash(slotIndex, jobIndex, inFile, outFPath, dedupHash);
+            return true;
         }
 
-        emit sendProgress(sizeIter);
-        sizeIter++;
+        return startFile(slotIndex, jobIndex, inFile, outFPath);
     }
 
-    calculateStats();
+    return false;
+}
+
+bool ConversionThread::startOrFetch(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, const QByteArray &contentHash)
+{
+    // the same source converted the same way before, maybe into another folder
+    QByteArray cacheKey;
+    if (m_cache.isOpen()) {
+        cacheKey = OutputCache::key(contentHash, encoderName(), m_encodeHash, m_extension);
+        if (!cacheKey.isEmpty() && fetchFromCache(cacheKey, fin, fout, jobIndex)) {
+            return false;
+        }
+        m_ls->addCacheMiss();
+    }
+
+    return startFile(slotIndex, jobIndex, fin, fout, cacheKey);
+}
+
+bool ConversionThread::startFile(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, const QByteArray &cacheKey)
+{
+    JobSlot &slot = m_slots[slotIndex];
+
+    slot.jobIndex = jobIndex;
+    slot.fin = fin;
+    slot.fout = fout;
+    slot.converted = false;
+    slot.cacheKey = cacheKey;
+    if (m_useNumThreads || m_autoConcurrency || m_memoryBudget > 0) {
+        const ImageInfo info = ImageInfo::probe(fin);
+        slot.pixels = info.pixels;
+        slot.bitDepth = info.bitDepth;
+    }
+    slot.isPending = true;
+    startPendingJob(slotIndex);
+    return true;
+}
+
+void ConversionThread::startHash(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, bool forDedup)
+{
+    JobSlot &slot = m_slots[slotIndex];
+
+    slot.jobIndex = jobIndex;
+    slot.fin = fin;
+    slot.fout = fout;
+    slot.isHashing = true;
+    slot.hashForDedup = forDedup;
+    slot.hashEarlier = forDedup ? m_dedup.beginHash(fin, jobIndex) : QVector<int>();
+
+    QStringList paths(fin.absoluteFilePath());
+    for (const int earlier : qAsConst(slot.hashEarlier)) {
+        paths.append(m_jobs->path(earlier));
+    }
+    slot.hashWatcher->setFuture(QtConcurrent::run(&m_hashPool, [paths]() {
+        QVector<QByteArray> hashes;
+        hashes.reserve(paths.size());
+        for (const QString &path : paths) {
+            hashes.append(ContentDedup::hashFile(path));
+        }
+        return hashes;
+    }));
 }
 
-bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QString &fout)
+void ConversionThread::finishHash(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+    // aborted while it was reading, already recorded
+    if (!slot.isHashing) {
+        return;
+    }
+    slot.isHashing = false;
+
+    const QVector<QByteArray> hashes = slot.hashWatcher->result();
+    const QFileInfo fin = slot.fin;
+    const QString fout = slot.fout;
+    const int jobIndex = slot.jobIndex;
+
+    int primary = -1;
+    if (slot.hashForDedup) {
+        QHash<int, QByteArray> earlier;
+        for (int i = 0; i < slot.hashEarlier.size(); i++) {
+            earlier.insert(slot.hashEarlier.at(i), hashes.value(i + 1));
+        }
+        primary = m_dedup.matchHash(fin, jobIndex, hashes.value(0), earlier);
+    }
+    slot.hashEarlier.clear();
+
+    bool started = false;
+    if (primary < 0 || !takeDuplicate({fin, fout, jobIndex}, primary)) {
+        started = startOrFetch(slotIndex, jobIndex, fin, fout, hashes.value(0));
+    }
+    if (!started) {
+        slot.busyMs += slot.busyTimer.elapsed();
+        if (!m_abort.loadAcquire() && slotIndex < m_jobLimit) {
+            startNextJob(slotIndex);
+        }
+    }
+
+    armDeadlineTimer();
+    quitIfDone();
+}
+
+bool ConversionThread::fetchFromCache(const QByteArray &cacheKey, const QFileInfo &fin, const QString &fout, int jobIndex)
+{
+    // a leftover of a killed run, cjxl would have written over it too
+    if (QFile::exists(fout)) {
+        QFile::remove(fout);
+    }
+    if (!trackCopy(m_cache.fetch(cacheKey, fout))) {
+        return false;
+    }
+
+    if (m_isMultithread) {
+        emit sendLogs(QString("Processing image:\n%1").arg(fin.absoluteFilePath()), Qt::white, LogCode::FILE_IN);
+    }
+    emit sendLogs(QString("Taken from the output cache\nOutput:\n%1\n").arg(fout), okayLogCol, LogCode::OK);
+
+    const qint64 outputSize = QFileInfo(fout).size();
+    m_totalBytesInput += fin.size();
+    m_totalBytesOutput += outputSize;
+    recordResult(jobIndex, LogCode::OK, fin.size(), fout, QString("cache"));
+    m_ls->addCacheHit();
+    m_manifest.record(fin, fout, outputSize);
+    if (m_keepDateTime) {
+        keepFileTimes(fin, fout);
+    }
+    if (m_useDedup) {
+        resolveDuplicates(jobIndex, fout);
+    }
+
+    m_progress.fetchAndAddRelaxed(1);
+    return true;
+}
+
+bool ConversionThread::takeDuplicate(const DedupSibling &sibling, int primary)
+{
+    // a hardlink of this one may already be waiting on it
+    const QVector<DedupSibling> riders = m_dedupWaiting.take(sibling.jobIndex);
+
+    const auto done = m_dedupDone.constFind(primary);
+    if (done == m_dedupDone.constEnd()) {
+        // still encoding, the copy is made once it lands
+        m_dedupWaiting[primary].append(sibling);
+        m_dedupWaiting[primary].append(riders);
+        return true;
+    }
+    if (!done.value().isEmpty()) {
+        materializeDuplicate(sibling, done.value());
+        for (const DedupSibling &rider : riders) {
+            materializeDuplicate(rider, done.value());
+        }
+        return true;
+    }
+
+    // the first one failed, this one is encoded on its own
+    if (!riders.isEmpty()) {
+        m_dedupWaiting.insert(sibling.jobIndex, riders);
+    }
+    return false;
+}
+
+void ConversionThread::resolveDuplicates(int jobIndex, const QString &source)
+{
+    m_dedupDone.insert(jobIndex, source);
+
+    const QVector<DedupSibling> siblings = m_dedupWaiting.take(jobIndex);
+    for (const DedupSibling &sibling : siblings) {
+        if (m_abort.loadAcquire()) {
+            recordResult(sibling.jobIndex, LogCode::ABORTED, -1, sibling.fout);
+        } else if (!source.isEmpty()) {
+            materializeDuplicate(sibling, source);
+        } else {
+            m_dedupRetry.append(sibling);
+        }
+    }
+}
+
+void ConversionThread::materializeDuplicate(const DedupSibling &sibling, const QString &source)
+{
+    if (m_isMultithread) {
+        emit sendLogs(QString("Processing image:\n%1").arg(sibling.fin.absoluteFilePath()), Qt::white, LogCode::FILE_IN);
+    }
+
+    if (sibling.fout != source && QFile::exists(sibling.fout)) {
+        QFile::remove(sibling.fout);
+    }
+
+    // a hardlink shares its times with the output it came from, each copy keeping its own
+    // input's dates needs a file of its own (still a reflink where the filesystem can)
+    if (sibling.fout == source
+        || trackCopy(m_keepDateTime ? FileCopy::copy(source, sibling.fout) : FileCopy::linkOrCopy(source, sibling.fout))) {
+        emit sendLogs(QString("Identical to an input encoded in this batch, output taken from:\n%1\n").arg(source),
+                      okayLogCol,
+                      LogCode::OK);
+        recordResult(sibling.jobIndex, LogCode::OK, sibling.fin.size(), sibling.fout, QString("dedup"));
+        m_ls->addDeduplicated();
+        m_manifest.record(sibling.fin, sibling.fout, QFileInfo(sibling.fout).size());
+        if (m_keepDateTime && sibling.fout != source) {
+            keepFileTimes(sibling.fin, sibling.fout);
+        }
+    } else {
+        emit sendLogs(QString("Identical to an input encoded in this batch, but its output couldn't be copied from:\n%1\n")
+                          .arg(source),
+                      errLogCol,
+                      LogCode::ENCODE_ERR_SKIP);
+        recordResult(sibling.jobIndex, LogCode::ENCODE_ERR_SKIP, -1, sibling.fout, QString("dedup"));
+    }
+
+    m_progress.fetchAndAddRelaxed(1);
+}
+
+bool ConversionThread::startPendingJob(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+    if (!slot.isPending) {
+        return false;
+    }
+
+    qint64 memEstimate = 0;
+    if (m_memoryBudget > 0) {
+        // a lone job always gets in, there is nothing to wait for
+        memEstimate = m_memEstimator.estimate(slot.pixels, slot.bitDepth);
+        if (m_memoryInUse + memEstimate > m_memoryBudget && runningJobs() > 0) {
+            return false;
+        }
+    }
+
+    // in-process jobs split the cores through the shared runner instead
+    if (m_useNumThreads && (!m_inProcess || m_useWorkerHost)) {
+        // stays pending until a running job hands its cores back
+        const int threads = m_coreBudget.acquire(slot.pixels, runningJobs());
+        if (threads <= 0) {
+            return false;
+        }
+        slot.threads = threads;
+    }
+
+    slot.memEstimate = memEstimate;
+    slot.peakRss = 0;
+    m_memoryInUse += memEstimate;
+
+    slot.isPending = false;
+    if (m_useWorkerHost) {
+        startWorkerJob(slot);
+    } else if (m_inProcess) {
+        startEncode(slot);
+    } else {
+        startCjxl(slot, slot.fin, slot.fout);
+    }
+    return true;
+}
+
+void ConversionThread::jobFinished(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+    if (!slot.isRunning) {
+        return;
+    }
+    slot.isRunning = false;
+
+    if (m_useNumThreads) {
+        m_coreBudget.release(slot.threads);
+        slot.threads = 0;
+    }
+
+    if (m_memoryBudget > 0) {
+        m_memoryInUse = std::max(m_memoryInUse - slot.memEstimate, (qint64)0);
+        slot.memEstimate = 0;
+    }
+
+    bool startNext = true;
+
+    if (slot.isAborted) {
+        emit sendLogs(QString("Aborted\n"), errLogCol, LogCode::INFO);
+        recordResult(slot, LogCode::ABORTED);
+        startNext = false;
+    } else if (slot.isTimedOut) {
+        emit sendLogs(QString("Skipped: Process exceeding set timeout of %1 second(s)\n")
+                          .arg(QString::number(m_globalTimeout)),
+                      warnLogCol,
+                      LogCode::SKIPPED_TIMEOUT);
+        recordResult(slot, LogCode::SKIPPED_TIMEOUT);
+        m_progress.fetchAndAddRelaxed(1);
+    } else if (!finishJob(slot)) {
+        startNext = false;
+        abortJobs();
+    } else {
+        m_progress.fetchAndAddRelaxed(1);
+        if (m_autoConcurrency) {
+            m_concurrency.addSample(slot.pixels);
+        }
+        if (m_memoryBudget > 0) {
+            m_memEstimator.addSample(slot.pixels, slot.bitDepth, slot.peakRss);
+        }
+    }
+
+    slot.busyMs += slot.busyTimer.elapsed();
+
+    if (m_useDedup) {
+        resolveDuplicates(slot.jobIndex, slot.converted ? slot.fout : QString());
+    }
+
+    if (startNext && !m_abort.loadAcquire() && slotIndex < m_jobLimit) {
+        startNextJob(slotIndex);
+    }
+    // freed cores may be enough for jobs that were waiting on the budget
+    for (int i = 0; i < m_slots.size() && !m_abort.loadAcquire(); i++) {
+        startPendingJob(i);
+    }
+    // retries of failed duplicates may need more slots than the one that just freed up
+    if (!m_dedupRetry.isEmpty() && !m_abort.loadAcquire()) {
+        startIdleSlots();
+    }
+    armDeadlineTimer();
+
+    quitIfDone();
+}
+
+bool ConversionThread::finishJob(JobSlot &slot)
+{
+    switch (slot.backend) {
+    case Backend::InProcess:
+        return finishEncode(slot);
+    case Backend::WorkerHost:
+        return finishWorkerJob(slot);
+    default:
+        return finishCjxl(slot);
+    }
+}
+
+void ConversionThread::killJob(JobSlot &slot)
+{
+    if (slot.backend == Backend::WorkerHost) {
+        slot.worker->kill();
+    } else if (!slot.viaHelper) {
+        slot.proc->kill();
+    } else if (m_spawner) {
+        m_spawner->kill(slot.spawnId);
+    }
+}
+
+int ConversionThread::slotForSpawn(int spawnId) const
+{
+    for (int i = 0; i < m_slots.size(); i++) {
+        if (m_slots[i].isRunning && m_slots[i].viaHelper && m_slots[i].spawnId == spawnId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ConversionThread::addSpawnSample(double ms)
+{
+    m_spawnLatencyMs += ms;
+    m_spawnSamples++;
+}
+
+void ConversionThread::abortJobs()
+{
+    m_abort.storeRelease(1);
+
+    // tells the folder scan to stop too
+    m_queue->close();
+
+    for (JobSlot &slot : m_slots) {
+        if (slot.isRunning && !slot.isAborted) {
+            slot.isAborted = true;
+            // an in-process encode sees m_abort at its next check and comes back on its own,
+            // libjxl itself can't be stopped in the middle of a frame
+            if (slot.backend != Backend::InProcess) {
+                killJob(slot);
+            }
+        } else if (slot.isPending || slot.isHashing) {
+            // a hash still being read is left to finish on the pool, its result is dropped
+            slot.isPending = false;
+            slot.isHashing = false;
+            emit sendLogs(QString("Aborted\n"), errLogCol, LogCode::INFO);
+            // never started, nothing of the slot's applies to this file yet
+            recordResult(slot.jobIndex, LogCode::ABORTED, -1, slot.fout);
+        }
+    }
+
+    if (runningJobs() == 0) {
+        quit();
+    }
+}
+
+void ConversionThread::armDeadlineTimer()
+{
+    if (!m_deadlineTimer) {
+        return;
+    }
+
+    // wake up only when the nearest per-process deadline runs out
+    qint64 nearest = -1;
+    for (const JobSlot &slot : qAsConst(m_slots)) {
+        if (slot.isRunning && !slot.isTimedOut && !slot.deadline.isForever()) {
+            const qint64 remaining = slot.deadline.remainingTime();
+            if (nearest < 0 || remaining < nearest) {
+                nearest = remaining;
+            }
+        }
+    }
+
+    if (nearest < 0) {
+        m_deadlineTimer->stop();
+    } else {
+        m_deadlineTimer->start(static_cast<int>(std::min(nearest, (qint64)INT_MAX)));
+    }
+}
+
+void ConversionThread::checkDeadlines()
+{
+    for (JobSlot &slot : m_slots) {
+        if (slot.backend != Backend::InProcess && slot.isRunning && !slot.isTimedOut && !slot.isAborted
+            && slot.deadline.hasExpired()) {
+            slot.isTimedOut = true;
+            killJob(slot);
+        }
+    }
+    armDeadlineTimer();
+}
+
+void ConversionThread::pollMemory()
+{
+    // the high-water mark only ever grows, the last read before exit is close enough,
+    // workers measure their own peak per job
+    for (JobSlot &slot : m_slots) {
+        if (slot.backend == Backend::Binary && slot.isRunning) {
+            const qint64 pid = slot.viaHelper ? slot.pid : slot.proc->processId();
+            if (pid > 0) {
+                slot.peakRss = std::max(slot.peakRss, MemoryEstimator::readPeakRss(pid));
+            }
+        }
+    }
+}
+
+int ConversionThread::runningJobs() const
+{
+    int running = 0;
+    for (const JobSlot &slot : m_slots) {
+        if (slot.isRunning) {
+            running++;
+        }
+    }
+    return running;
+}
+
+int ConversionThread::hashingJobs() const
+{
+    int hashing = 0;
+    for (const JobSlot &slot : m_slots) {
+        if (slot.isHashing) {
+            hashing++;
+        }
+    }
+    return hashing;
+}
+
+void ConversionThread::startCjxl(JobSlot &slot, const QFileInfo &fin, const QString &fout)
 {
     QStringList arg;
 
+    slot.fin = fin;
+    slot.fout = fout;
+    slot.mps = 0.0;
+    slot.isRunning = true;
+    slot.backend = Backend::Binary;
+    slot.isAborted = false;
+    slot.isTimedOut = false;
+    slot.failedToStart = false;
+
     const QString realFname = fin.completeBaseName();
     const QString fealFoutName = QFileInfo(fout).completeBaseName();
     bool notAscii = false;
@@ -409,7 +1393,7 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
                 outDirNotAscii = true;
             }
         }
-        if (m_tempFolderIn.isEmpty() || m_tempFolderOut.isEmpty()) {
+        if (slot.tempFolderIn.isEmpty() || slot.tempFolderOut.isEmpty()) {
             // bail if temp folders did not exist
             notAscii = false;
             outNotAscii = false;
@@ -428,11 +1412,11 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
     const QString inputAscii = [&](){
         if (notAscii || inDirNotAscii) {
             if (inDirNotAscii) {
-                QFile::copy(fin.absoluteFilePath(),
-                            QString("%1/%2").arg(m_tempFolderIn,
-                                                 notAscii ? fin.fileName().replace(realFname, asciiFname)
-                                                          : fin.fileName()));
-                return QFileInfo(QString("%1/%2").arg(m_tempFolderIn,
+                trackCopy(FileCopy::copy(fin.absoluteFilePath(),
+                                         QString("%1/%2").arg(slot.tempFolderIn,
+                                                              notAscii ? fin.fileName().replace(realFname, asciiFname)
+                                                                       : fin.fileName())));
+                return QFileInfo(QString("%1/%2").arg(slot.tempFolderIn,
                                                       notAscii ? fin.fileName().replace(realFname, asciiFname)
                                                                : fin.fileName()))
                     .absoluteFilePath();
@@ -451,7 +1435,7 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
                 fffout.setFile(ffout);
             }
             if (outDirNotAscii) {
-                QFileInfo offf(QString("%1/%2").arg(m_tempFolderOut, fffout.fileName()));
+                QFileInfo offf(QString("%1/%2").arg(slot.tempFolderOut, fffout.fileName()));
                 if (offf.exists()) {
                     quint64 increments = 0;
                     const QString cbsn = offf.completeBaseName();
@@ -488,6 +1472,13 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
         }
     }
 
+    slot.notAscii = notAscii;
+    slot.outNotAscii = outNotAscii;
+    slot.inDirNotAscii = inDirNotAscii;
+    slot.outDirNotAscii = outDirNotAscii;
+    slot.inputAscii = inputAscii;
+    slot.outputAscii = outputAscii;
+
     const bool isJpeg = [&]() {
         if (fin.suffix().contains("jpg", Qt::CaseInsensitive) || fin.suffix().contains("jpeg", Qt::CaseInsensitive)
             || fin.suffix().contains("jfif", Qt::CaseInsensitive)) {
@@ -515,37 +1506,38 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
         }
     }
 
-    cjxlBin.start(m_cjxlbin, arg);
+    if (m_useNumThreads && slot.threads > 0) {
+        arg << "--num_threads" << QString::number(slot.threads);
+    }
 
-    const bool haveTimeout = (m_globalTimeout > 0);
-    const qint64 timeout = m_globalTimeout * (1000 / (TICKS * TICKS_MULTIPLIER));
+    slot.deadline = (m_globalTimeout > 0) ? QDeadlineTimer(m_globalTimeout * 1000) : QDeadlineTimer(QDeadlineTimer::Forever);
+
+    slot.jobTimer.start();
+    slot.viaHelper = (m_spawner != nullptr);
+    if (slot.viaHelper) {
+        slot.pid = 0;
+        slot.exitCode = 0;
+        slot.stdErr.clear();
+        slot.stdOut.clear();
+        slot.spawnError.clear();
+        slot.spawnId = m_spawner->spawn(m_cjxlbin, arg);
+    } else {
+        slot.proc->start(m_cjxlbin, arg);
+    }
+}
 
-    mutex.lock();
-    m_ticks = 0;
-    mutex.unlock();
+bool ConversionThread::finishCjxl(JobSlot &slot)
+{
+    QProcess &cjxlBin = *slot.proc;
+    const QFileInfo &fin = slot.fin;
+    const QString &fout = slot.fout;
 
-    // poll the abort every defined poll rate
-    do {
-        if (m_abort) {
-            cjxlBin.kill();
-            cjxlBin.waitForFinished(5000);
-            emit sendLogs(QString("Aborted\n"), errLogCol, LogCode::INFO);
-            m_ls->addFiles(fin.absoluteFilePath(), LogCode::ABORTED);
-            return false;
-        }
-        if (haveTimeout) {
-            if (m_ticks > timeout) {
-                cjxlBin.kill();
-                cjxlBin.waitForFinished(5000);
-                emit sendLogs(QString("Skipped: Process exceeding set timeout of %1 second(s)\n")
-                                  .arg(QString::number(m_globalTimeout)),
-                              warnLogCol,
-                              LogCode::SKIPPED_TIMEOUT);
-                m_ls->addFiles(fin.absoluteFilePath(), LogCode::SKIPPED_TIMEOUT);
-                return true;
-            }
-        }
-    } while (!cjxlBin.waitForFinished(POLL_RATE_MS));
+    const bool notAscii = slot.notAscii;
+    const bool outNotAscii = slot.outNotAscii;
+    const bool inDirNotAscii = slot.inDirNotAscii;
+    const bool outDirNotAscii = slot.outDirNotAscii;
+    const QString &inputAscii = slot.inputAscii;
+    const QString &outputAscii = slot.outputAscii;
 
     if (notAscii || outNotAscii || inDirNotAscii || outDirNotAscii) {
         // Dirty hack: ...and rename it back after conversion
@@ -562,7 +1554,7 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
             if (QFile::exists(fout)) {
                 QFile::remove(fout);
             }
-            QFile::copy(outputAscii, fout);
+            trackCopy(FileCopy::copy(outputAscii, fout));
             QFile::remove(outputAscii);
             if (notAscii) {
                 QFile::remove(inputAscii);
@@ -570,12 +1562,14 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
         }
     }
 
-    const bool haveErrors = (cjxlBin.exitCode() != 0);
+    const int exitCode = slot.viaHelper ? slot.exitCode : cjxlBin.exitCode();
+    slot.exitCode = exitCode;
+    const bool haveErrors = (slot.failedToStart || exitCode != 0);
 
     static const QRegularExpression newLines("\n|\r\n|\r");
     static const QRegularExpression regNum("[^0-9.]");
 
-    const QString rawString = cjxlBin.readAllStandardError().trimmed();
+    const QString rawString = (slot.viaHelper ? slot.stdErr : cjxlBin.readAllStandardError()).trimmed();
     const QStringList rawStrList = rawString.split(newLines, Qt::SkipEmptyParts);
 
     if (m_isMultithread) {
@@ -583,6 +1577,10 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
         emit sendLogs(head, Qt::white, LogCode::FILE_IN);
     }
 
+    if (slot.failedToStart) {
+        emit sendLogs(QString("Failed to start process: %1").arg(slot.viaHelper ? slot.spawnError : cjxlBin.errorString()), errLogCol, LogCode::ENCODE_ERR_SKIP);
+    }
+
     if (!rawStrList.isEmpty()) {
         const QString buffer = rawStrList.join("\n");
 
@@ -602,15 +1600,77 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
             if (mps > 0.0) {
                 m_mpsSamples++;
                 m_averageMps = m_averageMps + mps;
+                slot.mps = mps;
+            }
+
+            // the stats line also tells the real dimensions, better than the probe guess
+            static const QRegularExpression regDims("(\\d+)\\s*x\\s*(\\d+)");
+            const QRegularExpressionMatch dims = regDims.match(lastLine.left(fr));
+            if (dims.hasMatch()) {
+                slot.pixels = dims.captured(1).toLongLong() * dims.captured(2).toLongLong();
             }
         }
     }
 
-    const QString rawStd = cjxlBin.readAllStandardOutput();
+    const QString rawStd = slot.viaHelper ? slot.stdOut : cjxlBin.readAllStandardOutput();
     if (!rawStd.isEmpty()) {
         emit sendLogs(rawStd, Qt::white, LogCode::INFO);
     }
 
+    return finishOutput(slot, haveErrors);
+}
+
+void ConversionThread::startEncode(JobSlot &slot)
+{
+    slot.mps = 0.0;
+    slot.isRunning = true;
+    slot.backend = Backend::InProcess;
+    slot.isAborted = false;
+    slot.isTimedOut = false;
+    slot.failedToStart = false;
+    slot.deadline = QDeadlineTimer(QDeadlineTimer::Forever);
+
+    const QString fin = slot.fin.absoluteFilePath();
+    const QString fout = slot.fout;
+
+    slot.jobTimer.start();
+    slot.watcher->setFuture(QtConcurrent::run(&m_encodePool, [this, fin, fout]() {
+        if (m_isDecode) {
+            return m_decoder.decode(fin, fout, &m_abort);
+        }
+        return m_encoder.encode(fin, fout, &m_abort);
+    }));
+}
+
+bool ConversionThread::finishEncode(JobSlot &slot)
+{
+    const LibJxlResult result = slot.watcher->result();
+    const bool haveErrors = !result.success;
+
+    if (m_isMultithread) {
+        const QString head = QString("Processing image:\n%1").arg(slot.fin.absoluteFilePath());
+        emit sendLogs(head, Qt::white, LogCode::FILE_IN);
+    }
+
+    emit sendLogs(result.log, haveErrors ? errLogCol : okayLogCol, haveErrors ? LogCode::ENCODE_ERR_SKIP : LogCode::OK);
+
+    if (result.mps > 0.0) {
+        m_mpsSamples++;
+        m_averageMps = m_averageMps + result.mps;
+        slot.mps = result.mps;
+    }
+    if (result.pixels > 0) {
+        slot.pixels = result.pixels;
+    }
+
+    return finishOutput(slot, haveErrors);
+}
+
+bool ConversionThread::finishOutput(JobSlot &slot, bool haveErrors)
+{
+    const QFileInfo &fin = slot.fin;
+    const QString &fout = slot.fout;
+
     // may change if file is copied
     QString absOutputFile(fout);
 
@@ -618,7 +1678,8 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
         emit sendLogs(QString("Copying source file to destination folder instead..."), warnLogCol, LogCode::INFO);
         const QFileInfo outp(fout);
         const QString outpfile = QDir::cleanPath(outp.absolutePath() + QDir::separator() + fin.fileName());
-        if (!QFile::copy(fin.absoluteFilePath(), outpfile)) {
+        const FileCopy::Result copied = FileCopy::copy(fin.absoluteFilePath(), outpfile);
+        if (!trackCopy(copied)) {
             if (QFile::exists(outpfile)) {
                 absOutputFile = outpfile;
                 emit sendLogs(QString("Cannot copy source file: file already exists on destination folder"), warnLogCol, LogCode::INFO);
@@ -627,7 +1688,10 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
             }
         } else {
             absOutputFile = outpfile;
-            emit sendLogs(QString("File copied."), warnLogCol, LogCode::INFO);
+            emit sendLogs(QString("File copied (%1, %2 bytes).")
+                              .arg(FileCopy::strategyName(copied.strategy), QString::number(copied.bytes)),
+                          warnLogCol,
+                          LogCode::INFO);
             // Seems unneccessary on Windows.
             // if (m_keepDateTime) {
             //     QFile outFileOpen(outpfile);
@@ -645,7 +1709,8 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
 
     if (haveErrors && m_stopOnError) {
         emit sendLogs(QString("Aborted: Batch set to stop on error\n"), errLogCol, LogCode::INFO);
-        m_ls->addFiles(fin.absoluteFilePath(), LogCode::ENCODE_ERR_ABORT);
+        recordResult(slot, LogCode::ENCODE_ERR_ABORT);
+        releaseOutput(fout);
         return false;
     }
 
@@ -670,36 +1735,298 @@ bool ConversionThread::runCjxl(QProcess &cjxlBin, const QFileInfo &fin, const QS
     if (m_ls) {
         if ((inFile.exists() && !absOutFile.exists() && !m_disableOutput)) {
             // output file didn't exist == failed conversion
-            m_ls->addFiles(inFile.absoluteFilePath(), LogCode::ENCODE_ERR_SKIP);
+            recordResult(slot, LogCode::ENCODE_ERR_SKIP, inFile.size());
         } else if (inFile.exists() && absOutFile.exists() && !m_disableOutput) {
             if (inFile.fileName() == absOutFile.fileName() && haveErrors) {
                 // output file exists, but with same extension and have conversion errors == copied file
-                m_ls->addFiles(inFile.absoluteFilePath(), LogCode::ENCODE_ERR_COPY);
+                recordResult(slot, LogCode::ENCODE_ERR_COPY, inFile.size());
             } else {
                 if (haveErrors) {
                     // output file exists but have errors == skipped file
-                    m_ls->addFiles(inFile.absoluteFilePath(), LogCode::ENCODE_ERR_SKIP);
+                    recordResult(slot, LogCode::ENCODE_ERR_SKIP, inFile.size());
                 } else {
                     // output file exists but have different extension == successful conversion
-                    m_ls->addFiles(inFile.absoluteFilePath(), LogCode::OK);
+                    recordResult(slot, LogCode::OK, inFile.size());
+                    m_manifest.record(inFile, fout, absOutFile.size());
+                    trackCopy(m_cache.store(slot.cacheKey, fout));
+                    slot.converted = true;
                 }
             }
         }
     }
 
     if (m_keepDateTime && outFile.exists()) {
-        QFile outFileOpen(fout);
-        outFileOpen.open(QIODevice::ReadWrite);
-        outFileOpen.setFileTime(inFile.fileTime(QFileDevice::FileBirthTime), QFileDevice::FileBirthTime);
-        outFileOpen.setFileTime(inFile.fileTime(QFileDevice::FileAccessTime), QFileDevice::FileAccessTime);
-        outFileOpen.setFileTime(inFile.fileTime(QFileDevice::FileMetadataChangeTime), QFileDevice::FileMetadataChangeTime);
-        outFileOpen.setFileTime(inFile.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
-        outFileOpen.close();
+        keepFileTimes(inFile, fout);
+    }
+
+    if (!slot.converted) {
+        releaseOutput(fout);
     }
 
     return true;
 }
 
+void ConversionThread::releaseOutput(const QString &fout)
+{
+    // nothing was written, a later input with the same output name may still have it
+    if (m_outDirs && !QFile::exists(fout)) {
+        const QFileInfo outFile(fout);
+        m_outDirs->releaseFile(outFile.path(), outFile.fileName());
+    }
+}
+
+void ConversionThread::keepFileTimes(const QFileInfo &fin, const QString &fout)
+{
+    QFile outFileOpen(fout);
+    outFileOpen.open(QIODevice::ReadWrite);
+    outFileOpen.setFileTime(fin.fileTime(QFileDevice::FileBirthTime), QFileDevice::FileBirthTime);
+    outFileOpen.setFileTime(fin.fileTime(QFileDevice::FileAccessTime), QFileDevice::FileAccessTime);
+    outFileOpen.setFileTime(fin.fileTime(QFileDevice::FileMetadataChangeTime), QFileDevice::FileMetadataChangeTime);
+    outFileOpen.setFileTime(fin.fileTime(QFileDevice::FileModificationTime), QFileDevice::FileModificationTime);
+    outFileOpen.close();
+}
+
+void ConversionThread::recordResult(int jobIndex, LogCode code, qint64 inputSize, const QString &output, const QString &via)
+{
+    RunReport::Row row;
+    row.output = output;
+    row.backend = via;
+    row.inputSize = inputSize;
+    row.code = code;
+    row.timedOut = (code == LogCode::SKIPPED_TIMEOUT);
+    row.aborted = (code == LogCode::ABORTED || code == LogCode::ENCODE_ERR_ABORT);
+    recordRow(jobIndex, row);
+}
+
+void ConversionThread::recordResult(const JobSlot &slot, LogCode code, qint64 inputSize)
+{
+    RunReport::Row row;
+    row.output = slot.fout;
+    switch (slot.backend) {
+    case Backend::Binary:
+        row.backend = QString("binary");
+        break;
+    case Backend::InProcess:
+        row.backend = QString("in-process");
+        break;
+    case Backend::WorkerHost:
+        row.backend = QString("worker host");
+        break;
+    }
+    row.inputSize = inputSize;
+    row.code = code;
+    row.wallMs = slot.jobTimer.elapsed();
+    row.mps = (slot.mps > 0.0) ? slot.mps : -1.0;
+    row.timedOut = slot.isTimedOut || (code == LogCode::SKIPPED_TIMEOUT);
+    row.aborted = slot.isAborted || (code == LogCode::ABORTED || code == LogCode::ENCODE_ERR_ABORT);
+    // libjxl linked in has no exit code, and a killed process's one means nothing
+    if (slot.backend != Backend::InProcess && !slot.failedToStart && !row.timedOut && !slot.isAborted) {
+        row.exitCode = slot.exitCode;
+    }
+    recordRow(slot.jobIndex, row);
+}
+
+void ConversionThread::recordRow(int jobIndex, RunReport::Row &row)
+{
+    m_ls->addJob(jobIndex, row.code);
+    m_jobs->setStatus(jobIndex, row.code);
+    if (row.inputSize >= 0) {
+        m_jobs->setInputSize(jobIndex, row.inputSize);
+    }
+
+    row.input = m_jobs->path(jobIndex);
+    emit sendResult(row.input, row.output, row.code);
+
+    if (!m_report.isOpen()) {
+        return;
+    }
+
+    // the sizes cost a stat each, only paid for with a report
+    if (row.inputSize < 0) {
+        const QFileInfo inFile(row.input);
+        if (inFile.exists()) {
+            row.inputSize = inFile.size();
+        }
+    }
+    if (!row.output.isEmpty() && (row.code & (LogCode::OK | LogCode::ENCODE_ERR_COPY | LogCode::SKIPPED_ALREADY_EXIST))) {
+        const QFileInfo outFile(row.output);
+        if (outFile.exists()) {
+            row.outputSize = outFile.size();
+        }
+    }
+    m_report.record(row);
+}
+
+bool ConversionThread::trackCopy(const FileCopy::Result &result)
+{
+    if (result.success) {
+        m_ls->addCopy(FileCopy::strategyName(result.strategy), result.bytes);
+    }
+    return result.success;
+}
+
+QString ConversionThread::encoderName() const
+{
+    // whatever actually encodes the batch, a fallback file still counts as this one
+    return m_inProcess ? LibJxlEncoder::version() : m_encoderVersion;
+}
+
+void ConversionThread::startWorkerJob(JobSlot &slot)
+{
+    slot.mps = 0.0;
+    slot.isRunning = true;
+    slot.backend = Backend::WorkerHost;
+    slot.isAborted = false;
+    slot.isTimedOut = false;
+    slot.failedToStart = false;
+    slot.workerCrashed = false;
+    slot.workerBuffer.clear();
+    slot.workerReply = WorkerReply();
+    slot.deadline = (m_globalTimeout > 0) ? QDeadlineTimer(m_globalTimeout * 1000) : QDeadlineTimer(QDeadlineTimer::Forever);
+
+    slot.jobTimer.start();
+
+    WorkerJob job;
+    job.id = ++m_workerJobId;
+    job.decode = m_isDecode;
+    // every worker has a runner of its own, without the core budget they split the machine
+    // evenly instead of each one sizing its runner for all of it
+    job.threads = m_useNumThreads ? slot.threads : qMax(QThread::idealThreadCount() / qMax(m_jobLimit, 1), 1);
+    job.input = slot.fin.absoluteFilePath();
+    job.output = slot.fout;
+    job.options = m_encOpts;
+
+    slot.workerJobId = job.id;
+    // what an earlier job printed after its log went out, or for one that went on to cjxl
+    slot.worker->readAllStandardError();
+    if (slot.worker->state() == QProcess::Running) {
+        slot.worker->write(job.toLine());
+        return;
+    }
+
+    // started once and then kept warm, a crashed or killed one gets replaced here. This is
+    // a plain QProcess rather than the spawn helper: the helper only hands back exit code and
+    // output at the end, a worker needs its stdin/stdout pipe for the whole batch, and it's
+    // forked once per slot, not once per file, so the fork cost barely shows.
+    // started() sends the job, errorOccurred() reports a failed start
+    slot.workerJobLine = job.toLine();
+    if (slot.worker->state() == QProcess::NotRunning) {
+        slot.worker->start(QCoreApplication::applicationFilePath(), QStringList() << EncoderWorker::argument());
+    }
+}
+
+void ConversionThread::readWorkerReply(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+    slot.workerBuffer += slot.worker->readAllStandardOutput();
+
+    // a leftover reply and the current one can come in with the same read, and there won't
+    // be another readyRead for the second, so every full line in the buffer is gone through
+    int newLine = slot.workerBuffer.indexOf('\n');
+    while (newLine >= 0) {
+        const QByteArray line = slot.workerBuffer.left(newLine);
+        slot.workerBuffer.remove(0, newLine + 1);
+        newLine = slot.workerBuffer.indexOf('\n');
+
+        if (!slot.isRunning || slot.backend != Backend::WorkerHost) {
+            continue;
+        }
+
+        WorkerReply reply;
+        if (!WorkerReply::fromLine(line, reply)) {
+            reply = WorkerReply();
+            reply.log = QString("Worker sent a malformed reply");
+        } else if (reply.id != slot.workerJobId) {
+            // leftover from a job that is already settled
+            continue;
+        }
+        slot.workerReply = reply;
+
+        // the slot moves on from here, whatever is still buffered belongs to no job
+        if (slot.workerReply.needsBinary && !m_abort.loadAcquire()) {
+            startCjxl(slot, slot.fin, slot.fout);
+            return;
+        }
+        jobFinished(slotIndex);
+        return;
+    }
+}
+
+void ConversionThread::workerExited(int slotIndex)
+{
+    JobSlot &slot = m_slots[slotIndex];
+    slot.workerBuffer.clear();
+
+    // an idle worker going away is fine, the next job starts a new one
+    if (!slot.isRunning || slot.backend != Backend::WorkerHost) {
+        return;
+    }
+
+    // the job went down with it, either killed for a timeout/abort or crashed on its own
+    if (!slot.isAborted && !slot.isTimedOut) {
+        slot.workerCrashed = true;
+    }
+    jobFinished(slotIndex);
+}
+
+bool ConversionThread::finishWorkerJob(JobSlot &slot)
+{
+    const WorkerReply &reply = slot.workerReply;
+    const bool haveErrors = (slot.failedToStart || slot.workerCrashed || reply.exitCode != 0);
+    slot.exitCode = slot.workerCrashed ? -1 : reply.exitCode;
+
+    if (m_isMultithread) {
+        const QString head = QString("Processing image:\n%1").arg(slot.fin.absoluteFilePath());
+        emit sendLogs(head, Qt::white, LogCode::FILE_IN);
+    }
+
+    // read per job so it never piles up in the pipe buffer over a batch, libjxl's own
+    // warnings or whatever a crashing worker got out before it went down
+    const QString errOut = QString::fromLocal8Bit(slot.worker->readAllStandardError()).trimmed();
+
+    if (slot.failedToStart) {
+        emit sendLogs(QString("Failed to start worker process: %1").arg(slot.worker->errorString()), errLogCol, LogCode::ENCODE_ERR_SKIP);
+    } else if (slot.workerCrashed) {
+        emit sendLogs(QString("Worker process crashed (exit code %1), a new one takes over from the next file%2")
+                          .arg(QString::number(slot.worker->exitCode()), errOut.isEmpty() ? QString() : QString("\n") + errOut),
+                      errLogCol,
+                      LogCode::ENCODE_ERR_SKIP);
+    } else if (!reply.log.isEmpty() || !errOut.isEmpty()) {
+        const QString log = (reply.log.isEmpty() || errOut.isEmpty()) ? reply.log + errOut : reply.log + QString("\n") + errOut;
+        emit sendLogs(log, haveErrors ? errLogCol : okayLogCol, haveErrors ? LogCode::ENCODE_ERR_SKIP : LogCode::OK);
+    }
+
+    if (!haveErrors) {
+        if (reply.mps > 0.0) {
+            m_mpsSamples++;
+            m_averageMps = m_averageMps + reply.mps;
+            slot.mps = reply.mps;
+        }
+        if (reply.pixels > 0) {
+            slot.pixels = reply.pixels;
+        }
+        slot.peakRss = reply.peakRss;
+    }
+
+    return finishOutput(slot, haveErrors);
+}
+
+void ConversionThread::stopWorkers()
+{
+    // closing stdin is the worker's cue to leave
+    for (JobSlot &slot : m_slots) {
+        if (slot.worker && slot.worker->state() != QProcess::NotRunning) {
+            slot.worker->closeWriteChannel();
+        }
+    }
+    for (JobSlot &slot : m_slots) {
+        if (slot.worker && slot.worker->state() != QProcess::NotRunning && !slot.worker->waitForFinished(1000)) {
+            slot.worker->kill();
+            slot.worker->waitForFinished(1000);
+        }
+    }
+}
+
 void ConversionThread::calculateStats()
 {
     if (!m_ls) {
@@ -729,20 +2056,38 @@ void ConversionThread::calculateStats()
 
 void ConversionThread::stopProcess()
 {
+    m_abort.storeRelease(1);
+
     mutex.lock();
-    m_abort = true;
+    if (m_loopCtx) {
+        // kill the running processes from the thread that owns them
+        QMetaObject::invokeMethod(
+            m_loopCtx,
+            [this]() {
+                abortJobs();
+            },
+            Qt::QueuedConnection);
+    }
     mutex.unlock();
+
+    // no more files wanted, also covers an abort before the loop is up
+    if (m_queue) {
+        m_queue->close();
+    }
 }
 
-void ConversionThread::timerEvent(QTimerEvent *event)
+void ConversionThread::setMaxJobs(int jobs)
 {
-    Q_UNUSED(event);
-
     mutex.lock();
-    m_ticks++;
-    mutex.unlock();
-
-    if (isFinished()) {
-        killTimer(event->timerId());
+    m_maxJobs = std::max(jobs, 1);
+    if (m_loopCtx) {
+        // resize the pool of a running batch from the thread that owns it
+        QMetaObject::invokeMethod(
+            m_loopCtx,
+            [this]() {
+                applyJobLimit();
+            },
+            Qt::QueuedConnection);
     }
+    mutex.unlock();
 }
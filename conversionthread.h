@@ -8,16 +8,40 @@
 #define CONVERSIONTHREAD_H
 
 #include "logcodes.h"
+#include "utils/batchmanifest.h"
+#include "utils/concurrencycontroller.h"
+#include "utils/contentdedup.h"
+#include "utils/corebudget.h"
+#include "utils/filecopy.h"
+#include "utils/jobqueue.h"
+#include "utils/jobtable.h"
+#include "utils/libjxldecoder.h"
+#include "utils/libjxlencoder.h"
+#include "utils/logring.h"
+#include "utils/memoryestimator.h"
+#include "utils/outputcache.h"
+#include "utils/outputdircache.h"
+#include "utils/runreport.h"
+#include "utils/spawnclient.h"
+#include "utils/workerprotocol.h"
 #include "utils/logstats.h"
 
+#include <QAtomicInt>
 #include <QProcess>
+#include <QDeadlineTimer>
 #include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QThread>
+#include <QThreadPool>
 #include <QMutex>
 #include <QMap>
+#include <QSharedPointer>
 #include <QColor>
-#include <QWaitCondition>
-#include <QTimerEvent>
+#include <QTimer>
+#include <QVector>
 
 class ConversionThread : public QThread
 {
@@ -27,25 +51,140 @@ public:
     ~ConversionThread();
 
     int processFiles(const QString &cjxlbin, QDirIterator &dit, const QString &fout, const QMap<QString, QString> &args);
-    int processFilesWithList(const QString &cjxlbin, const QStringList &fin, const QString &fout, const QMap<QString, QString> &args, const bool useList);
+    int processFilesWithList(const QString &cjxlbin, const QSharedPointer<JobQueue> &queue, const QString &fout, const QMap<QString, QString> &args, const bool useList);
     int processFiles(const QString &cjxlbin, const QStringList &fin, const QString &fout, const QMap<QString, QString> &args);
+    void setOutputDirs(const QSharedPointer<OutputDirCache> &outDirs);
+
+    // sendLogs is emitted on the conversion thread, the GUI collects it from here on a timer
+    LogRing *logRing();
+    // files done so far, read instead of a signal per file
+    int progress() const;
 
 signals:
     void sendLogs(const QString &logs, const QColor &col, const LogCode &isErr);
-    void sendProgress(const float &prog);
+    // once per file, whatever sendLogs showed for it (or didn't, in silent mode)
+    void sendResult(const QString &input, const QString &output, const LogCode &code);
 
 public slots:
     void stopProcess();
+    void setMaxJobs(int jobs);
 
 protected:
     void run() override;
-    void timerEvent(QTimerEvent *event) override;
 
 private:
+    // what is working on a slot's current file
+    enum class Backend {
+        Binary,
+        InProcess,
+        WorkerHost
+    };
+
+    // an input with the same content as one already being encoded, waits for that one's output
+    struct DedupSibling {
+        QFileInfo fin;
+        QString fout;
+        int jobIndex = 0;
+    };
+
+    // one concurrently running process and the state of the file it works on
+    struct JobSlot {
+        QProcess *proc = nullptr;
+        QProcess *worker = nullptr;
+        QFutureWatcher<LibJxlResult> *watcher = nullptr;
+        QFutureWatcher<QVector<QByteArray>> *hashWatcher = nullptr;
+        QVector<int> hashEarlier;
+        QByteArray workerBuffer;
+        QByteArray workerJobLine;
+        WorkerReply workerReply;
+        QFileInfo fin;
+        QString fout;
+        QString inputAscii;
+        QString outputAscii;
+        QString tempFolderIn;
+        QString tempFolderOut;
+        QDeadlineTimer deadline;
+        QElapsedTimer busyTimer;
+        QElapsedTimer jobTimer;
+        QByteArray stdErr;
+        QByteArray stdOut;
+        QString spawnError;
+        qint64 busyMs = 0;
+        qint64 pixels = 0;
+        qint64 memEstimate = 0;
+        qint64 peakRss = 0;
+        qint64 pid = 0;
+        double mps = 0.0;
+        int bitDepth = 8;
+        int jobIndex = 0;
+        int threads = 0;
+        int workerJobId = 0;
+        int spawnId = 0;
+        int exitCode = 0;
+        Backend backend = Backend::Binary;
+        bool isPending = false;
+        bool isRunning = false;
+        bool isHashing = false;
+        bool hashForDedup = false;
+        bool isAborted = false;
+        bool isTimedOut = false;
+        bool failedToStart = false;
+        bool workerCrashed = false;
+        bool viaHelper = false;
+        bool converted = false;
+        QByteArray cacheKey;
+        bool notAscii = false;
+        bool outNotAscii = false;
+        bool inDirNotAscii = false;
+        bool outDirNotAscii = false;
+    };
+
     void initArgs(const QMap<QString, QString> &args);
     void calculateStats();
     void resetValues();
-    bool runCjxl(QProcess &jxlBin, const QFileInfo &fin, const QString &fout);
+    void addJobSlot();
+    void applyJobLimit();
+    void startIdleSlots();
+    void queueChanged();
+    void quitIfDone();
+    bool startNextJob(int slotIndex);
+    bool startFile(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, const QByteArray &cacheKey = QByteArray());
+    bool startOrFetch(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, const QByteArray &contentHash);
+    void startHash(int slotIndex, int jobIndex, const QFileInfo &fin, const QString &fout, bool forDedup);
+    void finishHash(int slotIndex);
+    bool startPendingJob(int slotIndex);
+    bool fetchFromCache(const QByteArray &cacheKey, const QFileInfo &fin, const QString &fout, int jobIndex);
+    bool takeDuplicate(const DedupSibling &sibling, int primary);
+    void resolveDuplicates(int jobIndex, const QString &source);
+    void materializeDuplicate(const DedupSibling &sibling, const QString &source);
+    void keepFileTimes(const QFileInfo &fin, const QString &fout);
+    void releaseOutput(const QString &fout);
+    bool trackCopy(const FileCopy::Result &result);
+    void recordResult(int jobIndex, LogCode code, qint64 inputSize = -1, const QString &output = QString(), const QString &via = QString());
+    void recordResult(const JobSlot &slot, LogCode code, qint64 inputSize = -1);
+    void recordRow(int jobIndex, RunReport::Row &row);
+    QString encoderName() const;
+    void startCjxl(JobSlot &slot, const QFileInfo &fin, const QString &fout);
+    bool finishCjxl(JobSlot &slot);
+    void startEncode(JobSlot &slot);
+    bool finishEncode(JobSlot &slot);
+    bool finishOutput(JobSlot &slot, bool haveErrors);
+    void startWorkerJob(JobSlot &slot);
+    void readWorkerReply(int slotIndex);
+    void workerExited(int slotIndex);
+    bool finishWorkerJob(JobSlot &slot);
+    void stopWorkers();
+    void jobFinished(int slotIndex);
+    bool finishJob(JobSlot &slot);
+    void killJob(JobSlot &slot);
+    int slotForSpawn(int spawnId) const;
+    void addSpawnSample(double ms);
+    void abortJobs();
+    void armDeadlineTimer();
+    void checkDeadlines();
+    void pollMemory();
+    int runningJobs() const;
+    int hashingJobs() const;
 
     bool m_isJpegTran = false;
     bool m_isOverwrite = false;
@@ -58,15 +197,36 @@ private:
     bool m_isMultithread = false;
     bool m_keepDateTime = false;
     bool m_processNonAscii = false;
+    bool m_useNumThreads = false;
+    bool m_autoConcurrency = false;
+    bool m_inProcess = false;
+    bool m_isDecode = false;
+    bool m_useWorkerHost = false;
+    bool m_useManifest = false;
+    bool m_useDedup = false;
+    bool m_resumeFromManifest = false;
+    bool m_useReport = false;
 
     double m_averageMps = 0.0;
+    double m_spawnLatencyMs = 0.0;
     int m_mpsSamples = 0;
+    int m_spawnSamples = 0;
+    int m_maxJobs = 1;
+    int m_effort = 7;
+    int m_jobLimit = 1;
+    int m_workerJobId = 0;
     uint m_globalTimeout = 0;
     qint64 m_totalBytesInput = 0;
     qint64 m_totalBytesOutput = 0;
-    qint64 m_ticks = 0;
+    qint64 m_memoryBudget = 0;
+    qint64 m_memoryInUse = 0;
+    qint64 m_cacheLimit = 0;
 
     QString m_cjxlbin;
+    QString m_cacheDir;
+    QString m_encodeHash;
+    QString m_encoderVersion;
+    QString m_inProcessFallback;
     QString m_fin;
     QString m_fout;
     QString m_extension;
@@ -75,14 +235,41 @@ private:
     QString m_tempFolderIn;
     QString m_tempFolderOut;
     QStringList m_args;
-    QStringList m_finBatch;
     QStringList m_customArgs;
     QMap<QString, QString> m_encOpts;
+    QSharedPointer<JobQueue> m_queue;
+    QSharedPointer<JobTable> m_jobs;
+    QSharedPointer<OutputDirCache> m_outDirs;
+    QVector<JobSlot> m_slots;
+    CoreBudget m_coreBudget;
+    ConcurrencyController m_concurrency;
+    MemoryEstimator m_memEstimator;
+    BatchManifest m_manifest;
+    ContentDedup m_dedup;
+    OutputCache m_cache;
+    RunReport m_report;
+    RunReport::Format m_reportFormat = RunReport::Format::Jsonl;
+    QHash<int, QVector<DedupSibling>> m_dedupWaiting;
+    QHash<int, QString> m_dedupDone;
+    QList<DedupSibling> m_dedupRetry;
+    LibJxlEncoder m_encoder;
+    LibJxlDecoder m_decoder;
+    QThreadPool m_encodePool;
+    QThreadPool m_hashPool;
+
+    LogRing m_logRing;
+    QAtomicInt m_progress{0};
+
+    QObject *m_loopCtx = nullptr;
+    QTimer *m_deadlineTimer = nullptr;
+    SpawnClient *m_spawner = nullptr;
 
     LogStats *m_ls = nullptr;
 
     QMutex mutex;
-    bool m_abort = false;
+    QAtomicInt m_wakeQueued;
+    // set from the GUI thread, read all over the loop and by in-process encodes to bail out early
+    QAtomicInt m_abort{0};
 };
 
 #endif // CONVERSIONTHREAD_H
@@ -2,6 +2,8 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+QT += concurrent
+
 CONFIG += c++17
 
 # You can make your code fail to compile if it uses deprecated APIs.
@@ -12,20 +14,79 @@ SOURCES += \
     conversionthread.cpp \
     main.cpp \
     mainwindow.cpp \
+    utils/batchmanifest.cpp \
+    utils/concurrencycontroller.cpp \
+    utils/contentdedup.cpp \
+    utils/corebudget.cpp \
+    utils/dircrawler.cpp \
+    utils/encoderworker.cpp \
+    utils/filecopy.cpp \
+    utils/filemirror.cpp \
     utils/folderselectiondialog.cpp \
-    utils/logstats.cpp
+    utils/imageinfo.cpp \
+    utils/jobqueue.cpp \
+    utils/jobtable.cpp \
+    utils/libjxldecoder.cpp \
+    utils/libjxlencoder.cpp \
+    utils/logfilewriter.cpp \
+    utils/logring.cpp \
+    utils/logstats.cpp \
+    utils/memoryestimator.cpp \
+    utils/outputcache.cpp \
+    utils/outputdircache.cpp \
+    utils/pathtrie.cpp \
+    utils/runreport.cpp \
+    utils/spawnclient.cpp \
+    utils/spawnhelper.cpp \
+    utils/workerprotocol.cpp
 
 HEADERS += \
     conversionthread.h \
     logcodes.h \
     mainwindow.h \
+    utils/batchmanifest.h \
+    utils/concurrencycontroller.h \
+    utils/contentdedup.h \
+    utils/corebudget.h \
+    utils/dircrawler.h \
+    utils/encoderworker.h \
+    utils/filecopy.h \
+    utils/filemirror.h \
     utils/folderselectiondialog.h \
-    utils/logstats.h
+    utils/imageinfo.h \
+    utils/jobqueue.h \
+    utils/jobtable.h \
+    utils/libjxldecoder.h \
+    utils/libjxlencoder.h \
+    utils/libjxlresult.h \
+    utils/logfilewriter.h \
+    utils/logring.h \
+    utils/logstats.h \
+    utils/memoryestimator.h \
+    utils/outputcache.h \
+    utils/outputdircache.h \
+    utils/pathtrie.h \
+    utils/runreport.h \
+    utils/spawnclient.h \
+    utils/spawnhelper.h \
+    utils/workerprotocol.h
 
 FORMS += \
     mainwindow.ui \
     utils/folderselectiondialog.ui
 
+# peak memory of child processes
+win32: LIBS += -lpsapi
+
+# optional in-process encoder/decoder, everything still works through cjxl without it
+CONFIG += link_pkgconfig
+packagesExist(libjxl) {
+    PKGCONFIG += libjxl
+    DEFINES += HAVE_LIBJXL
+    SOURCES += utils/sharedparallelrunner.cpp
+    HEADERS += utils/sharedparallelrunner.h
+}
+
 VERSION = 0.6.0
 DEFINES += APP_VERSION=\\\"$$VERSION\\\"
 
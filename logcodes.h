@@ -18,6 +18,9 @@ enum LogCode {
     ABORTED = 1 << 10
 };
 
+// one past the highest bit above, for tables indexed by code
+static constexpr int LogCodeCount = 11;
+
 Q_DECLARE_METATYPE(LogCode);
 
 static const QColor warnLogCol(255, 255, 100);
@@ -6,11 +6,25 @@
 
 #include "mainwindow.h"
 #include "logcodes.h"
+#include "utils/encoderworker.h"
+#include "utils/spawnhelper.h"
 
 #include <QApplication>
 
+#include <cstring>
+
 int main(int argc, char *argv[])
 {
+    // headless worker spawned by ConversionThread, no window here
+    if (argc > 1 && std::strcmp(argv[1], EncoderWorker::argument()) == 0) {
+        QCoreApplication a(argc, argv);
+        return EncoderWorker::exec();
+    }
+    // process launcher for ConversionThread, stays tiny on purpose
+    if (argc > 1 && std::strcmp(argv[1], SpawnHelper::argument()) == 0) {
+        return SpawnHelper::exec();
+    }
+
     QApplication a(argc, argv);
 
     qRegisterMetaType<LogCode>();
@@ -7,6 +7,12 @@
 #include "mainwindow.h"
 #include "conversionthread.h"
 #include "ui_mainwindow.h"
+#include "utils/dircrawler.h"
+#include "utils/filemirror.h"
+#include "utils/jobqueue.h"
+#include "utils/logfilewriter.h"
+#include "utils/libjxlencoder.h"
+#include "utils/outputdircache.h"
 #include "utils/logstats.h"
 #include "utils/folderselectiondialog.h"
 
@@ -17,10 +23,16 @@
 #include <QFileDialog>
 #include <QProcess>
 #include <QSettings>
+#include <QStandardPaths>
 #include <QMimeData>
 #include <QScreen>
+#include <QScrollBar>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTimer>
 #include <QMessageBox>
 #include <QRandomGenerator>
+#include <QtConcurrent>
 
 #define RANDOM_STR_LEN 4
 #define RANDOM_STR_TRIES 100
@@ -50,7 +62,12 @@ public:
     int m_fullVer = 0;
 
     QList<ConversionThread *> m_threadList;
+    QFuture<void> m_scanFuture;
+    QSharedPointer<JobQueue> m_scanQueue;
+    QTimer *m_logTimer{nullptr};
+    LogFileWriter *m_logFile{nullptr};
     QElapsedTimer m_eTimer;
+    qint64 m_workStartMs = 0;
     QSettings *m_currentSetting;
 
     LogStats *ls{nullptr};
@@ -134,6 +151,7 @@ MainWindow::MainWindow(QWidget *parent)
     recursiveChk->setChecked(d->m_currentSetting->value("recursive", false).toBool());
     inputFileDir->setText(d->m_currentSetting->value("inDir").toString());
     inclHiddenChk->setChecked(d->m_currentSetting->value("inclHiddenChk").toBool());
+    mirrorOtherChk->setChecked(d->m_currentSetting->value("mirrorOtherFiles", false).toBool());
     excludeFolderBtn->setEnabled(recursiveChk->isChecked());
 
     inputTab->setCurrentIndex(d->m_currentSetting->value("inputTabIndex", 0).toInt());
@@ -144,6 +162,9 @@ MainWindow::MainWindow(QWidget *parent)
     overrideExtChk->setChecked(d->m_currentSetting->value("overrideExtChk", false).toBool());
     overrideExtLine->setText(d->m_currentSetting->value("overrideExtText", QString("jpg;png;gif")).toString());
     keepDateChkBox->setChecked(d->m_currentSetting->value("keepDateChkBox", false).toBool());
+    resumeManifestChk->setChecked(d->m_currentSetting->value("resumeManifest", false).toBool());
+    dedupChk->setChecked(d->m_currentSetting->value("dedupInputs", false).toBool());
+    reportCombo->setCurrentIndex(qBound(0, d->m_currentSetting->value("runReport", 0).toInt(), reportCombo->count() - 1));
     sameFolderChk->setChecked(d->m_currentSetting->value("sameFolderChk", false).toBool());
     if (sameFolderChk->isChecked() && inputTab->currentIndex() == 0) {
         outputFileDir->setEnabled(!sameFolderChk->isChecked());
@@ -199,10 +220,27 @@ MainWindow::MainWindow(QWidget *parent)
     threadSpinBox->setMinimum(1);
     threadSpinBox->setValue(std::max(std::min((quint32)d->m_currentSetting->value("maxThreads").toUInt(), (quint32)(QThread::idealThreadCount() - 2)), (quint32)1));
 
+    coreBudgetSpinBox->setMaximum(std::max(QThread::idealThreadCount(), (int)1));
+    coreBudgetSpinBox->setMinimum(1);
+    coreBudgetSpinBox->setValue(d->m_currentSetting->value("coreBudget", QThread::idealThreadCount()).toInt());
+    autoThreadsChk->setChecked(d->m_currentSetting->value("autoThreads", false).toBool());
+    ramBudgetSpinBox->setValue(d->m_currentSetting->value("ramBudget", 0).toInt());
+    outputCacheSpinBox->setValue(d->m_currentSetting->value("outputCache", 0).toInt());
+    inProcessChk->setChecked(d->m_currentSetting->value("inProcessEncode", false).toBool() && LibJxlEncoder::isAvailable());
+    if (!LibJxlEncoder::isAvailable()) {
+        inProcessChk->setEnabled(false);
+        inProcessChk->setToolTip(QString("This build doesn't include libjxl"));
+    } else {
+        inProcessChk->setText(QString("Use in-process %1 (cjxl/djxl tabs)").arg(LibJxlEncoder::version()));
+    }
+    workerHostChk->setChecked(d->m_currentSetting->value("workerHost", false).toBool());
+    workerHostChk->setEnabled(inProcessChk->isChecked());
+
     glbTimeoutSpinBox->setValue(d->m_currentSetting->value("globalTimeout").toUInt());
     stopOnErrorchkBox->setChecked(d->m_currentSetting->value("stopOnError", false).toBool());
     copyOnErrorchk->setChecked(d->m_currentSetting->value("copyOnError", false).toBool());
     maxLinesSpinBox->setValue(d->m_currentSetting->value("maxLogLines", 1000).toInt());
+    logToFileChk->setChecked(d->m_currentSetting->value("logToFile", false).toBool());
     deleteInputAfterConvChk->setChecked(d->m_currentSetting->value("deleteInputAfterConvChk").toBool());
     deleteInputPermaChk->setChecked(d->m_currentSetting->value("deleteInputPermaChk").toBool());
     alsoDeleteSkipChk->setChecked(d->m_currentSetting->value("alsoDeleteSkipChk").toBool());
@@ -233,10 +271,25 @@ MainWindow::MainWindow(QWidget *parent)
 
     d->m_execBin = new QProcess(this);
 
+    // conversion logs and progress are picked up at a fixed rate, however fast the files go
+    d->m_logTimer = new QTimer(this);
+    d->m_logTimer->setInterval(50);
+    connect(d->m_logTimer, &QTimer::timeout, this, &MainWindow::drainLogs);
+
     connect(libjxlBinBtn, SIGNAL(clicked(bool)), this, SLOT(libjxlBtnPressed()));
     connect(inputFileBtn, SIGNAL(clicked(bool)), this, SLOT(inputBtnPressed()));
     connect(outputFileBtn, SIGNAL(clicked(bool)), this, SLOT(outputBtnPressed()));
     connect(convertBtn, SIGNAL(clicked(bool)), this, SLOT(convertBtnPressed()));
+    // before the first file shows up there are no threads to stop yet, only the scan,
+    // and a startBatch already posted sees the queue is gone and does nothing
+    connect(abortBtn, &QPushButton::clicked, this, [&]() {
+        if (d->m_scanQueue && d->m_threadList.isEmpty()) {
+            stopScan();
+            dumpLogs(QString("Aborted before any file was converted"), errLogCol, LogCode::INFO);
+            resetUi();
+            progressBar->setVisible(false);
+        }
+    });
     connect(printHelpBtn, SIGNAL(clicked(bool)), this, SLOT(printHelpBtnPressed()));
 
     connect(selectionTabWdg, SIGNAL(currentChanged(int)), this, SLOT(tabIndexChanged(int)));
@@ -273,6 +326,11 @@ MainWindow::MainWindow(QWidget *parent)
         excludeFolderBtn->setEnabled(recursiveChk->isChecked());
     });
 
+    connect(inProcessChk, &QCheckBox::stateChanged, this, [&](const int &v) {
+        Q_UNUSED(v);
+        workerHostChk->setEnabled(inProcessChk->isChecked());
+    });
+
     connect(aboutQtButton, &QPushButton::clicked, this, [&]() {
         QMessageBox::aboutQt(this);
     });
@@ -298,6 +356,9 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // the crawl and the mirror post back to this window, they have to be gone first
+    stopScan();
+    delete d->m_logFile;
     delete d;
 }
 
@@ -306,6 +367,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
     d->m_currentSetting->setValue("execBinDir", libjxlBinDir->text());
     d->m_currentSetting->setValue("recursive", recursiveChk->isChecked());
     d->m_currentSetting->setValue("inclHiddenChk", inclHiddenChk->isChecked());
+    d->m_currentSetting->setValue("mirrorOtherFiles", mirrorOtherChk->isChecked());
 
     d->m_currentSetting->setValue("inputTabIndex", inputTab->currentIndex());
     d->m_currentSetting->setValue("appendLists", appendListsChk->isChecked());
@@ -316,6 +378,9 @@ void MainWindow::closeEvent(QCloseEvent *event)
     d->m_currentSetting->setValue("overrideExtChk", overrideExtChk->isChecked());
     d->m_currentSetting->setValue("overrideExtText", overrideExtLine->text());
     d->m_currentSetting->setValue("keepDateChkBox", keepDateChkBox->isChecked());
+    d->m_currentSetting->setValue("resumeManifest", resumeManifestChk->isChecked());
+    d->m_currentSetting->setValue("dedupInputs", dedupChk->isChecked());
+    d->m_currentSetting->setValue("runReport", reportCombo->currentIndex());
     d->m_currentSetting->setValue("sameFolderChk", sameFolderChk->isChecked());
     d->m_currentSetting->setValue("clearListAfterConvChk", clearListAfterConvChk->isChecked());
     d->m_currentSetting->setValue("outSuffixChk", outSuffixChk->isChecked());
@@ -337,6 +402,12 @@ void MainWindow::closeEvent(QCloseEvent *event)
     d->m_currentSetting->setValue("fastDecode", fasterDecodeSpinBox->value());
 
     d->m_currentSetting->setValue("maxThreads", threadSpinBox->value());
+    d->m_currentSetting->setValue("coreBudget", coreBudgetSpinBox->value());
+    d->m_currentSetting->setValue("autoThreads", autoThreadsChk->isChecked());
+    d->m_currentSetting->setValue("ramBudget", ramBudgetSpinBox->value());
+    d->m_currentSetting->setValue("outputCache", outputCacheSpinBox->value());
+    d->m_currentSetting->setValue("inProcessEncode", inProcessChk->isChecked());
+    d->m_currentSetting->setValue("workerHost", workerHostChk->isChecked());
     d->m_currentSetting->setValue("customFlagsChk", custFlagsChkBox->isChecked());
     d->m_currentSetting->setValue("customFlagsStr", custFlagsText->toPlainText());
     d->m_currentSetting->setValue("overrideFlags", overrideOptChkBox->isChecked());
@@ -359,6 +430,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
     d->m_currentSetting->setValue("stopOnError", stopOnErrorchkBox->isChecked());
     d->m_currentSetting->setValue("copyOnError", copyOnErrorchk->isChecked());
     d->m_currentSetting->setValue("maxLogLines", maxLinesSpinBox->value());
+    d->m_currentSetting->setValue("logToFile", logToFileChk->isChecked());
     d->m_currentSetting->setValue("deleteInputAfterConvChk", deleteInputAfterConvChk->isChecked());
     d->m_currentSetting->setValue("deleteInputPermaChk", deleteInputPermaChk->isChecked());
     d->m_currentSetting->setValue("alsoDeleteSkipChk", alsoDeleteSkipChk->isChecked());
@@ -597,7 +669,15 @@ void MainWindow::convertBtnPressed()
     convOptBox->setEnabled(false);
     selectionTabWdg->setEnabled(false);
     addGlbSetGrp->setEnabled(false);
+    // the pool size stays adjustable while running
+    autoThreadsChk->setEnabled(false);
+    coreBudgetSpinBox->setEnabled(false);
+    ramBudgetSpinBox->setEnabled(false);
+    outputCacheSpinBox->setEnabled(false);
+    inProcessChk->setEnabled(false);
+    workerHostChk->setEnabled(false);
     maxLinesSpinBox->setEnabled(false);
+    logToFileChk->setEnabled(false);
 
     logText->document()->setMaximumBlockCount(maxLinesSpinBox->value());
 
@@ -715,8 +795,61 @@ void MainWindow::convertBtnPressed()
     encOptions.insert("globalTimeout", QString::number(glbTimeoutSpinBox->value()));
     encOptions.insert("globalStopOnError", (stopOnErrorchkBox->isChecked() ? "1" : "0"));
     encOptions.insert("globalCopyOnError", (copyOnErrorchk->isChecked() ? "1" : "0"));
-    encOptions.insert("useMultithread", ((threadSpinBox->value() > 1) ? "1" : "0"));
+    encOptions.insert("useMultithread", ((threadSpinBox->value() > 1 || autoThreadsChk->isChecked()) ? "1" : "0"));
+    encOptions.insert("autoThreads", (autoThreadsChk->isChecked() ? "1" : "0"));
+    if (ramBudgetSpinBox->value() > 0) {
+        encOptions.insert("ramBudget", QString::number(ramBudgetSpinBox->value() * 1024));
+    }
+    if ((selectedTabIndex == 0 || selectedTabIndex == 1) && inProcessChk->isChecked()) {
+        encOptions.insert("inProcess", (selectedTabIndex == 0) ? "encode" : "decode");
+        if (workerHostChk->isChecked()) {
+            encOptions.insert("workerHost", "1");
+        }
+    }
+    // cjxl/djxl get their --num_threads from the shared core budget
+    if ((selectedTabIndex == 0 || selectedTabIndex == 1) && d->m_fullVer >= 7000) {
+        encOptions.insert("coreBudget", QString::number(coreBudgetSpinBox->value()));
+    }
     encOptions.insert("keepDateTime", (keepDateChkBox->isChecked() ? "1" : "0"));
+    if (dedupChk->isChecked()) {
+        encOptions.insert("dedup", "1");
+    }
+    if (outputCacheSpinBox->value() > 0) {
+        // the folder can be moved somewhere roomier by hand in the settings file
+        encOptions.insert("outputCacheDir",
+                          d->m_currentSetting
+                              ->value("outputCacheDir",
+                                      QDir::cleanPath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QDir::separator()
+                                                      + QString("outputs")))
+                              .toString());
+        encOptions.insert("outputCacheLimit", QString::number(outputCacheSpinBox->value() * 1024));
+    }
+    if (reportCombo->currentIndex() > 0) {
+        encOptions.insert("runReport", (reportCombo->currentIndex() == 2) ? "csv" : "jsonl");
+    }
+    if (resumeManifestChk->isChecked() || outputCacheSpinBox->value() > 0 || reportCombo->currentIndex() > 0) {
+        // a re-run only skips what was made with the same options and the same encoder,
+        // and the cache only hands out what was, the report just names them
+        if (resumeManifestChk->isChecked()) {
+            encOptions.insert("resumeManifest", "1");
+        }
+        encOptions.insert("encodeHash", encodeHash);
+        encOptions.insert("encoderVersion", [&]() {
+            switch (selectedTabIndex) {
+            case 0:
+                return d->m_cjxlVerString;
+            case 1:
+                return d->m_djxlVerString;
+            case 2:
+                return d->m_cjpegliVerString;
+            case 3:
+                return d->m_djpegliVerString;
+            default:
+                break;
+            }
+            return QString();
+        }());
+    }
     QString randomSuffix;
     if (outSuffixChk->isChecked() && !outSuffixLine->text().isEmpty()) {
         QString outSfx = outSuffixLine->text();
@@ -838,158 +971,204 @@ void MainWindow::convertBtnPressed()
             inUrl.setPath(inFile.absoluteFilePath());
         }
 
-        QDirIterator dit(inUrl.absolutePath(),
-                         spFormats,
-                         QDir::Files | (inclHiddenChk->isChecked() ? QDir::Hidden : QDir::Files),
-                         isRecursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
-
-        if (!dit.hasNext()) {
-            dumpLogs(QString("Error: directory contains no file(s) to convert!"), errLogCol, LogCode::INFO);
-            resetUi();
-            progressBar->setVisible(false);
-            return;
-        }
+        // several folder listings in flight, and every folder's files go to the queue as soon as
+        // they're listed, so conversion starts on the first match instead of after the whole scan
+        const QSharedPointer<JobQueue> jobQueue(new JobQueue());
+        const QString scanRoot = inUrl.absolutePath();
+        const QSharedPointer<OutputDirCache> outDirs(new OutputDirCache(outputDirStr, scanRoot));
+        outDirs->setSkipExisting(!overwriteChkBox->isChecked());
+        const bool inclHidden = inclHiddenChk->isChecked();
+        const QStringList excludedFolders = d->m_excludedFolders;
+        // copying the other files next to themselves makes no sense
+        const bool mirrorOthers = mirrorOtherChk->isChecked() && QDir::cleanPath(inFUrl) != QDir::cleanPath(outputDirStr);
+        // hardlinks share the inode with the source, so only when asked for in the settings file
+        const bool mirrorHardlinks = d->m_currentSetting->value("mirrorHardlinks", false).toBool();
+        const bool overwrite = overwriteChkBox->isChecked();
+
+        // the output suffix check below needs the first file, so the rest of the batch is set up
+        // from the event loop once the scan finds one, the GUI never sits waiting on the crawl
+        auto startBatch = [=]() mutable {
+            // the notifier holds this lambda and this lambda holds the queue, let go of it
+            jobQueue->setNotifier(nullptr);
+            // a batch reset (or aborted) before its first file, nothing left to start
+            if (d->m_scanQueue != jobQueue) {
+                return;
+            }
+            if (jobQueue->isEmpty()) {
+                dumpLogs(QString("Error: directory contains no file(s) to convert!"), errLogCol, LogCode::INFO);
+                resetUi();
+                progressBar->setVisible(false);
+                return;
+            }
+            const QString firstFile = jobQueue->first();
 
-        QStringList dits;
-        while (dit.hasNext()) {
-            const QString ditto = dit.next();
-            // This was (supposed to be) a safety check, but since it did it in one go,
-            // there's no risk of triggering infinite recursion.
-            // Scratch that, I still need it to exclude output dir if it's inside the input dir
+            // suffix addition
+            bool useHash = false;
+            if (!randomSuffix.isEmpty()) {
+                QString osf = outSuffixLine->text();
+                QFileInfo inFileFirstTmp(firstFile);
 
-            const bool ctnOutput = [&]() {
-                return !ditto.contains(outputDirStr)
-                    // hack: in case user inputs folder that's outside the input but having the same (base) name
-                    // eg: input, input12, input-xyz
-                    || !((QString(ditto).remove(outputDirStr).startsWith("/")
-                          || QString(ditto).remove(outputDirStr).startsWith("\\")));
-            }();
+                QDir inUrlTmp;
+                if (inFileFirstTmp.isFile()) {
+                    inUrlTmp.setPath(inFileFirstTmp.absolutePath());
+                } else {
+                    inUrlTmp.setPath(inFileFirstTmp.absoluteFilePath());
+                }
 
-            if (!d->m_excludedFolders.isEmpty()) {
-                bool skip = false;
-                foreach (const auto &fld, d->m_excludedFolders) {
-                    if ((ditto.contains(fld)
-                          && (QString(ditto).remove(fld).startsWith("/")
-                              || QString(ditto).remove(fld).startsWith("\\")))) {
-                        skip = true;
+                const QString basePathTmp = inUrlTmp.absolutePath();
+
+                const QFileInfo inFileTmp(firstFile);
+                const QString foutTmp = outputDirStr;
+                const QString extraDirNameTmp = QString(inFileTmp.absolutePath()).remove(basePathTmp);
+                // without list
+                const QDir outFUrlTmp = QDir::cleanPath(foutTmp + extraDirNameTmp);
+
+                QString outFNameTmp = inFileTmp.completeBaseName()
+                    + (osf.isEmpty() ? QString() : QString("-%1").arg(QString(osf.replace("%rnd%", randomSuffix)))) + outFmt;
+                QString outFPathTmp = QDir::cleanPath(outFUrlTmp.path() + QDir::separator() + outFNameTmp);
+                QFileInfo outFileTmp(outFPathTmp);
+
+                // dear me, I hope no one ever reached 56,800,235,584 random suffixes
+                // that may cause (near) an infinite loop here...
+                quint64 numTries = 0;
+                while (outFileTmp.exists()) {
+                    // let's limit the tries considerably
+                    if (numTries > RANDOM_STR_TRIES) {
                         break;
                     }
+                    numTries++;
+                    randomSuffix = getRandomString(RANDOM_STR_LEN);
+                    QString osfTmp = outSuffixLine->text();
+                    outFNameTmp = inFileTmp.completeBaseName()
+                        + (osf.isEmpty() ? QString() : QString("-%1").arg(QString(osfTmp.replace("%rnd%", randomSuffix)))) + outFmt;
+                    outFPathTmp = QDir::cleanPath(outFUrlTmp.path() + QDir::separator() + outFNameTmp);
+                    outFileTmp.setFile(outFPathTmp);
+                }
+
+                QString osff = outSuffixLine->text();
+                osff.replace("%rnd%", randomSuffix);
+                if (osff.contains("%hash%")) {
+                    useHash = true;
+                    osff.replace("%hash%", encodeHash);
                 }
-                if (skip) {
-                    continue;
+                encOptions.insert("outSuffix", osff);
+            } else if (!outSuffixLine->text().isEmpty() && outSuffixChk->isChecked()) {
+                QString osff = outSuffixLine->text();
+                if (osff.contains("%hash%")) {
+                    useHash = true;
+                    osff.replace("%hash%", encodeHash);
                 }
+                encOptions.insert("outSuffix", osff);
             }
 
-            if (ctnOutput || (inFUrl == outputDirStr)) {
-                dits.append(ditto);
+            if (useHash) {
+                QFile hashOpts;
+                hashOpts.setFileName(QDir::cleanPath(outputDirStr + QDir::separator() + QString("encode-opts-%1.txt").arg(encodeHash)));
+                hashOpts.open(QIODevice::WriteOnly);
+                hashOpts.write(opts.toUtf8());
+                hashOpts.close();
             }
-        }
 
-        if (dits.isEmpty()) {
-            dumpLogs(QString("Error: directory contains no file(s) to convert!"), errLogCol, LogCode::INFO);
-            resetUi();
-            progressBar->setVisible(false);
-            return;
-        }
+            // a single event-driven thread keeps numthr processes going, all pulling from the same queue,
+            // which the scan is still filling
+            const int numthr = threadSpinBox->value();
 
-        // suffix addition
-        bool useHash = false;
-        if (!randomSuffix.isEmpty()) {
-            QString osf = outSuffixLine->text();
-            QFileInfo inFileFirstTmp(dits.at(0));
+            d->m_multithreadNum = 1;
 
-            QDir inUrlTmp;
-            if (inFileFirstTmp.isFile()) {
-                inUrlTmp.setPath(inFileFirstTmp.absolutePath());
-            } else {
-                inUrlTmp.setPath(inFileFirstTmp.absoluteFilePath());
-            }
+            ConversionThread *ct = new ConversionThread();
+            ct->processFilesWithList(binPath, jobQueue, outputDirStr, encOptions, false);
+            ct->setOutputDirs(outDirs);
+            ct->setMaxJobs(numthr);
+            connect(threadSpinBox, SIGNAL(valueChanged(int)), ct, SLOT(setMaxJobs(int)));
+            d->m_threadList.append(ct);
 
-            const QString basePathTmp = inUrlTmp.absolutePath();
+            progressBar->setMaximum(jobQueue->size());
 
-            const QFileInfo inFileTmp(dits.at(0));
-            const QString foutTmp = outputDirStr;
-            const QString extraDirNameTmp = QString(inFileTmp.absolutePath()).remove(basePathTmp);
-            // without list
-            const QDir outFUrlTmp = QDir::cleanPath(foutTmp + extraDirNameTmp);
+            d->m_workStartMs = d->m_eTimer.elapsed();
 
-            QString outFNameTmp = inFileTmp.completeBaseName()
-                + (osf.isEmpty() ? QString() : QString("-%1").arg(QString(osf.replace("%rnd%", randomSuffix)))) + outFmt;
-            QString outFPathTmp = QDir::cleanPath(outFUrlTmp.path() + QDir::separator() + outFNameTmp);
-            QFileInfo outFileTmp(outFPathTmp);
+            startThreads(opts);
+        };
 
-            // dear me, I hope no one ever reached 56,800,235,584 random suffixes
-            // that may cause (near) an infinite loop here...
-            quint64 numTries = 0;
-            while (outFileTmp.exists()) {
-                // let's limit the tries considerably
-                if (numTries > RANDOM_STR_TRIES) {
-                    break;
-                }
-                numTries++;
-                randomSuffix = getRandomString(RANDOM_STR_LEN);
-                QString osfTmp = outSuffixLine->text();
-                outFNameTmp = inFileTmp.completeBaseName()
-                    + (osf.isEmpty() ? QString() : QString("-%1").arg(QString(osfTmp.replace("%rnd%", randomSuffix)))) + outFmt;
-                outFPathTmp = QDir::cleanPath(outFUrlTmp.path() + QDir::separator() + outFNameTmp);
-                outFileTmp.setFile(outFPathTmp);
+        // called under the queue's lock on the scan thread, only hands over to the GUI, once;
+        // set before the scan starts so the first append can't be missed
+        const QSharedPointer<QAtomicInt> firstSeen(new QAtomicInt(0));
+        jobQueue->setNotifier([this, firstSeen, startBatch]() {
+            if (firstSeen->testAndSetOrdered(0, 1)) {
+                QMetaObject::invokeMethod(this, startBatch, Qt::QueuedConnection);
             }
+        });
 
-            QString osff = outSuffixLine->text();
-            osff.replace("%rnd%", randomSuffix);
-            if (osff.contains("%hash%")) {
-                useHash = true;
-                osff.replace("%hash%", encodeHash);
+        d->m_scanQueue = jobQueue;
+        d->m_scanFuture = QtConcurrent::run([=]() {
+            DirCrawler crawler(scanRoot, spFormats, inclHidden, isRecursive);
+
+            // excluded folders and the output dir (when it sits inside the input) are cut off
+            // when the crawl reaches them, none of their contents gets listed
+            QStringList skipFolders = excludedFolders;
+            if (QDir::cleanPath(inFUrl) != QDir::cleanPath(outputDirStr)) {
+                skipFolders.append(outputDirStr);
             }
-            encOptions.insert("outSuffix", osff);
-        } else if (!outSuffixLine->text().isEmpty() && outSuffixChk->isChecked()) {
-            QString osff = outSuffixLine->text();
-            if (osff.contains("%hash%")) {
-                useHash = true;
-                osff.replace("%hash%", encodeHash);
+            crawler.setExcludedFolders(skipFolders);
+
+            // a closed queue means the batch was aborted, no point in scanning further
+            crawler.setBatchHandler([&](const QStringList &files) {
+                // one batch is one folder, its output folder is made (or listed) before any worker
+                // needs it, a failure is left for the worker to retry and report per file
+                outDirs->ensure(outDirs->outputDirFor(QFileInfo(files.first()).absolutePath()));
+                if (!jobQueue->append(files)) {
+                    return false;
+                }
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, jobQueue]() {
+                        progressBar->setMaximum(jobQueue->size());
+                    },
+                    Qt::QueuedConnection);
+                return true;
+            });
+
+            // files that aren't converted go to the output tree from the same listing
+            FileMirror mirror(outDirs, overwrite, mirrorHardlinks);
+            if (mirrorOthers) {
+                crawler.setOtherFilesHandler([&](const QStringList &files) {
+                    if (jobQueue->isClosed()) {
+                        return false;
+                    }
+                    mirror.mirror(files);
+                    return true;
+                });
             }
-            encOptions.insert("outSuffix", osff);
-        }
 
-        if (useHash) {
-            QFile hashOpts;
-            hashOpts.setFileName(QDir::cleanPath(outputDirStr + QDir::separator() + QString("encode-opts-%1.txt").arg(encodeHash)));
-            hashOpts.open(QIODevice::WriteOnly);
-            hashOpts.write(opts.toUtf8());
-            hashOpts.close();
-        }
+            QElapsedTimer scanTimer;
+            scanTimer.start();
+            crawler.crawl();
 
-        const int numthr = threadSpinBox->value();
-        const int bucketSize = dits.size() / numthr;
-        QList<QStringList> ditlist;
-        for (int i = 0; i < numthr; i++) {
-            if (i == numthr - 1) {
-                ditlist.append(dits.mid(i*bucketSize, -1));
-            } else {
-                ditlist.append(dits.mid(i*bucketSize, bucketSize));
+            // the batch isn't done until the mirror is, an abort closes the queue
+            while (!mirror.waitForDone(100)) {
+                if (jobQueue->isClosed()) {
+                    mirror.stop();
+                }
             }
-        }
-
-        d->m_multithreadNum = numthr;
-        if (numthr > 1) {
-            d->m_useMultithread = true;
-        }
 
-        foreach (const auto &c, ditlist) {
-            ConversionThread *ct = new ConversionThread();
-            ct->processFilesWithList(binPath, c, outputDirStr, encOptions, false);
-            d->m_threadList.append(ct);
-        }
-
-        progressBar->setMaximum(dits.size());
+            // posted before the queue closes, so it can't land after the batch summary
+            if (!crawler.wasStopped() && !jobQueue->isClosed()) {
+                const QString scanLog =
+                    QString("Scanned %1 folder(s), skipped %2 excluded, found %3 file(s), created %4 output folder(s) in %5 s\n")
+                        .arg(QString::number(crawler.foldersScanned()),
+                             QString::number(crawler.foldersExcluded()),
+                             QString::number(jobQueue->size()),
+                             QString::number(outDirs->created()),
+                             QString::number(scanTimer.elapsed() / 1000.0, 'f', 2));
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, scanLog]() {
+                        dumpLogs(scanLog, statLogCol, LogCode::INFO);
+                    },
+                    Qt::QueuedConnection);
+            }
+            jobQueue->close();
+        });
 
-        foreach (const auto &ct, d->m_threadList) {
-            connect(abortBtn, SIGNAL(clicked(bool)), ct, SLOT(stopProcess()));
-            connect(ct, SIGNAL(sendLogs(QString, QColor, LogCode)), this, SLOT(dumpLogs(QString, QColor, LogCode)));
-            connect(ct, SIGNAL(finished()), this, SLOT(resetUi()));
-            connect(ct, SIGNAL(sendProgress(float)), this, SLOT(dumpProgress(float)));
-            ct->start();
-        }
 
         return;
 
@@ -1073,37 +1252,23 @@ void MainWindow::convertBtnPressed()
             hashOpts.close();
         }
 
+        // a single event-driven thread keeps numthr processes going, all pulling from the same queue
         const int numthr = threadSpinBox->value();
-        const int bucketSize = dit.size() / numthr;
-        QList<QStringList> ditlist;
-        for (int i = 0; i < numthr; i++) {
-            if (i == numthr - 1) {
-                ditlist.append(dit.mid(i*bucketSize, -1));
-            } else {
-                ditlist.append(dit.mid(i*bucketSize, bucketSize));
-            }
-        }
+        const QSharedPointer<JobQueue> jobQueue(new JobQueue(dit));
 
-        d->m_multithreadNum = numthr;
-        if (numthr > 1) {
-            d->m_useMultithread = true;
-        }
+        d->m_multithreadNum = 1;
 
-        foreach (const auto &c, ditlist) {
-            ConversionThread *ct = new ConversionThread();
-            ct->processFilesWithList(binPath, c, outputDirStr, encOptions, true);
-            d->m_threadList.append(ct);
-        }
+        ConversionThread *ct = new ConversionThread();
+        ct->processFilesWithList(binPath, jobQueue, outputDirStr, encOptions, true);
+        ct->setMaxJobs(numthr);
+        connect(threadSpinBox, SIGNAL(valueChanged(int)), ct, SLOT(setMaxJobs(int)));
+        d->m_threadList.append(ct);
 
         progressBar->setMaximum(dit.size());
 
-        foreach (const auto &ct, d->m_threadList) {
-            connect(abortBtn, SIGNAL(clicked(bool)), ct, SLOT(stopProcess()));
-            connect(ct, SIGNAL(sendLogs(QString, QColor, LogCode)), this, SLOT(dumpLogs(QString, QColor, LogCode)));
-            connect(ct, SIGNAL(finished()), this, SLOT(resetUi()));
-            connect(ct, SIGNAL(sendProgress(float)), this, SLOT(dumpProgress(float)));
-            ct->start();
-        }
+        d->m_workStartMs = d->m_eTimer.elapsed();
+
+        startThreads(opts);
 
         return;
     }
@@ -1191,6 +1356,9 @@ void MainWindow::tabIndexChanged(const int &index)
 
 void MainWindow::resetUi()
 {
+    // whatever the threads logged since the last tick comes before the summary
+    drainLogs();
+
     // multithreading is tough lol
     d->m_threadCounter++;
     if (!d->m_threadList.isEmpty()) {
@@ -1204,14 +1372,31 @@ void MainWindow::resetUi()
         foreach (const auto &ct, d->m_threadList) {
             if (ct) {
                 disconnect(abortBtn, SIGNAL(clicked(bool)), ct, SLOT(stopProcess()));
-                disconnect(ct, SIGNAL(sendLogs(QString, QColor, LogCode)), this, SLOT(dumpLogs(QString, QColor, LogCode)));
                 disconnect(ct, SIGNAL(finished()), this, SLOT(resetUi()));
-                disconnect(ct, SIGNAL(sendProgress(float)), this, SLOT(dumpProgress(float)));
                 delete ct;
             }
         }
         d->m_threadList.clear();
+        d->m_logTimer->stop();
+
+        if (d->m_logFile) {
+            d->m_logFile->write(QString("Batch finished in %1 s: %2 converted, %3 skipped, %4 timeout(s), %5 error(s), %6 aborted")
+                                    .arg(QString::number(d->m_eTimer.elapsed() / 1000.0, 'f', 1),
+                                         QString::number(d->ls->countFiles(LogCode::OK)),
+                                         QString::number(d->ls->countFiles(LogCode::SKIPPED_ALREADY_EXIST)),
+                                         QString::number(d->ls->countFiles(LogCode::SKIPPED_TIMEOUT)),
+                                         QString::number(d->ls->countFiles(LogCode::OUT_FOLDER_ERR | LogCode::ENCODE_ERR_SKIP
+                                                                           | LogCode::ENCODE_ERR_COPY | LogCode::ENCODE_ERR_ABORT)),
+                                         QString::number(d->ls->countFiles(LogCode::ABORTED))),
+                                LogCode::INFO);
+            // waits for the last lines to hit the disk
+            delete d->m_logFile;
+            d->m_logFile = nullptr;
+        }
     }
+    // a batch that never got to start its threads still has its scan to end
+    stopScan();
+
     // make absolutely sure the next process is only called once per resetUi...
     if (d->m_useMultithread && (d->m_threadCounter < d->m_multithreadNum)) {
         return;
@@ -1433,6 +1618,63 @@ void MainWindow::resetUi()
             logText->setTextColor(Qt::white);
         }
 
+        if (const auto busyTimes = d->ls->readWorkerBusyTimes(); busyTimes.size() > 1) {
+            const qint64 workTime = d->m_eTimer.elapsed() - d->m_workStartMs;
+            QStringList idleTimes;
+            for (int i = 0; i < busyTimes.size(); i++) {
+                const qint64 idleMs = std::max(workTime - busyTimes.at(i), (qint64)0);
+                idleTimes.append(QString("#%1: %2s").arg(QString::number(i + 1), QString::number(idleMs / 1000.0)));
+            }
+            logText->append(QString("\nWorker idle time: %1").arg(idleTimes.join(", ")));
+        }
+
+        const quint64 deduplicated = d->ls->readDeduplicated();
+        if (deduplicated > 0) {
+            logText->append(QString("\nEncodes avoided by deduplication: %1").arg(QString::number(deduplicated)));
+        }
+
+        const quint64 cacheHits = d->ls->readCacheHits();
+        if (const auto lookups = cacheHits + d->ls->readCacheMisses(); lookups > 0) {
+            logText->append(QString("\nOutput cache: %1 hit(s), %2 miss(es)")
+                                .arg(QString::number(cacheHits), QString::number(lookups - cacheHits)));
+        }
+
+        if (const auto mirrored = d->ls->readMirrored(), skipped = d->ls->readMirrorSkipped(); mirrored + skipped > 0) {
+            logText->append(QString("\nMirrored %1 other file(s), %2 MiB, %3 already in the output")
+                                .arg(QString::number(mirrored),
+                                     QString::number(d->ls->readMirroredBytes() / (1024.0 * 1024.0), 'f', 1),
+                                     QString::number(skipped)));
+        }
+        if (const auto failed = d->ls->readMirrorFailed(); !failed.isEmpty()) {
+            logText->setTextColor(errLogCol);
+            logText->append(QString("\nFailed to mirror %1 file(s):").arg(QString::number(failed.size())));
+            foreach (const auto &f, failed) {
+                logText->append(f);
+            }
+            logText->setTextColor(Qt::white);
+        }
+
+        if (const auto copies = d->ls->readCopies(); !copies.isEmpty()) {
+            QStringList copyStats;
+            for (auto it = copies.constBegin(); it != copies.constEnd(); ++it) {
+                copyStats.append(QString("%1 x%2 (%3 MiB)")
+                                     .arg(it.key(),
+                                          QString::number(it.value().first),
+                                          QString::number(it.value().second / (1024.0 * 1024.0), 'f', 1)));
+            }
+            logText->append(QString("\nFile copies: %1").arg(copyStats.join(", ")));
+        }
+
+        // files actually handed to an encoder, so backends can be compared on the same batch
+        if (const auto encoded = d->ls->countFiles(LogCode::OK | LogCode::ENCODE_ERR_SKIP | LogCode::ENCODE_ERR_COPY) - deduplicated - cacheHits;
+            encoded > 0) {
+            const qint64 workTime = d->m_eTimer.elapsed() - d->m_workStartMs;
+            if (workTime > 0) {
+                logText->append(QString("\nThroughput: %1 file(s)/s with %2")
+                                    .arg(QString::number(encoded / (workTime / 1000.0), 'f', 2), d->ls->readEncoderBackend()));
+            }
+        }
+
         logText->append(QString("\nElapsed time: %1 second(s)").arg(QString::number(decodeTime)));
         logText->setTextColor(Qt::darkGray);
         logText->append(separator);
@@ -1450,7 +1692,14 @@ void MainWindow::resetUi()
     abortBtn->setEnabled(false);
     convOptBox->setEnabled(true);
     addGlbSetGrp->setEnabled(true);
+    autoThreadsChk->setEnabled(true);
+    coreBudgetSpinBox->setEnabled(true);
+    ramBudgetSpinBox->setEnabled(true);
+    outputCacheSpinBox->setEnabled(true);
+    inProcessChk->setEnabled(LibJxlEncoder::isAvailable());
+    workerHostChk->setEnabled(inProcessChk->isChecked());
     maxLinesSpinBox->setEnabled(true);
+    logToFileChk->setEnabled(true);
 }
 
 void MainWindow::dirChkChange()
@@ -1458,6 +1707,87 @@ void MainWindow::dirChkChange()
     // reserved
 }
 
+void MainWindow::startThreads(const QString &opts)
+{
+    openLogFile(opts);
+
+    foreach (const auto &ct, d->m_threadList) {
+        connect(abortBtn, SIGNAL(clicked(bool)), ct, SLOT(stopProcess()));
+        // straight into the ring on the conversion thread, no queued event per line
+        LogRing *ring = ct->logRing();
+        LogFileWriter *logFile = d->m_logFile;
+        connect(
+            ct,
+            &ConversionThread::sendLogs,
+            ct,
+            [ring, logFile](const QString &logs, const QColor &col, const LogCode &isErr) {
+                if (!logs.isEmpty()) {
+                    ring->push(logs, col, isErr);
+                }
+                if (logFile) {
+                    logFile->write(logs, isErr);
+                }
+            },
+            Qt::DirectConnection);
+        if (logFile) {
+            connect(
+                ct,
+                &ConversionThread::sendResult,
+                ct,
+                [logFile](const QString &input, const QString &output, const LogCode &code) {
+                    logFile->writeResult(code, input, output);
+                },
+                Qt::DirectConnection);
+        }
+        connect(ct, SIGNAL(finished()), this, SLOT(resetUi()));
+        ct->start();
+    }
+    d->m_logTimer->start();
+}
+
+void MainWindow::stopScan()
+{
+    // a closed queue stops the crawl and the mirror, an empty future returns right away
+    if (d->m_scanQueue) {
+        d->m_scanQueue->close();
+        // still the GUI's notifier when no thread took the queue over
+        if (d->m_threadList.isEmpty()) {
+            d->m_scanQueue->setNotifier(nullptr);
+        }
+        d->m_scanQueue.clear();
+    }
+    d->m_scanFuture.waitForFinished();
+}
+
+void MainWindow::openLogFile(const QString &opts)
+{
+    delete d->m_logFile;
+    d->m_logFile = nullptr;
+
+    if (!logToFileChk->isChecked()) {
+        return;
+    }
+
+    // the folder and rotation can be changed by hand in the settings file
+    const QString dir =
+        d->m_currentSetting->value("logFileDir", QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/logs")
+            .toString();
+    const qint64 maxBytes = d->m_currentSetting->value("logFileMaxMiB", 64).toLongLong() * 1024 * 1024;
+    const int keepFiles = d->m_currentSetting->value("logFileKeep", 5).toInt();
+
+    LogFileWriter *logFile = new LogFileWriter(dir, maxBytes, keepFiles);
+    QString error;
+    if (!logFile->open(&error)) {
+        delete logFile;
+        dumpLogs(QString("Not writing a log file: %1\n").arg(error), warnLogCol, LogCode::INFO);
+        return;
+    }
+
+    d->m_logFile = logFile;
+    d->m_logFile->write(QString("Batch started with\n%1").arg(opts), LogCode::INFO);
+    dumpLogs(QString("Writing the full log to %1\n").arg(QDir::toNativeSeparators(logFile->filePath())), statLogCol, LogCode::INFO);
+}
+
 void MainWindow::dumpLogs(const QString &logs, const QColor &col, const LogCode &isErr)
 {
     Q_UNUSED(isErr);
@@ -1477,13 +1807,82 @@ void MainWindow::dumpLogs(const QString &logs, const QColor &col, const LogCode
     }
 }
 
-void MainWindow::dumpProgress(const float &prog)
+void MainWindow::drainLogs()
 {
-    Q_UNUSED(prog);
-    const int val = progressBar->value() + 1;
+    if (d->m_threadList.isEmpty()) {
+        return;
+    }
+
+    QVector<LogRing::Entry> entries;
+    quint64 dropped = 0;
+    int done = 0;
+    foreach (const auto &ct, d->m_threadList) {
+        if (ct) {
+            ct->logRing()->drain(entries);
+            dropped += ct->logRing()->takeDropped();
+            done += ct->progress();
+        }
+    }
+
     progressBar->setVisible(true);
-    // progressBar->setValue(prog);
-    progressBar->setValue(val);
+    progressBar->setValue(done);
+
+    if (entries.isEmpty() && dropped == 0) {
+        return;
+    }
+
+    QScrollBar *scroll = logText->verticalScrollBar();
+    const bool atBottom = (scroll->value() == scroll->maximum());
+
+    // one edit block per tick, and a run of lines in the same colour goes in as one insert
+    QTextCursor cursor(logText->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    bool stopOnError = false;
+    const auto insertRun = [&](const QString &text, const QColor &col) {
+        QTextCharFormat format;
+        format.setForeground(col);
+        if (!logText->document()->isEmpty()) {
+            cursor.insertBlock();
+        }
+        cursor.insertText(text, format);
+    };
+    QString run;
+    QColor runColor;
+    for (const LogRing::Entry &entry : qAsConst(entries)) {
+        if (entry.text.contains("Aborted: Batch set to stop on error")) {
+            stopOnError = true;
+        }
+        if (!run.isNull() && entry.color != runColor) {
+            insertRun(run, runColor);
+            run = QString();
+        }
+        if (run.isNull()) {
+            run = entry.text;
+            runColor = entry.color;
+        } else {
+            run += QLatin1Char('\n') + entry.text;
+        }
+    }
+    if (!run.isNull()) {
+        insertRun(run, runColor);
+    }
+    if (dropped > 0) {
+        insertRun(QString("(%1 log line(s) dropped, the log couldn't keep up)").arg(QString::number(dropped)), warnLogCol);
+    }
+    cursor.endEditBlock();
+
+    if (atBottom) {
+        scroll->setValue(scroll->maximum());
+    }
+
+    if (stopOnError) {
+        foreach (const auto &ct, d->m_threadList) {
+            if (ct->isRunning()) {
+                ct->stopProcess();
+            }
+        }
+    }
 }
 
 void MainWindow::cjxlChecker()
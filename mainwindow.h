@@ -24,6 +24,9 @@ public:
 
 private:
     void cjxlChecker();
+    void openLogFile(const QString &opts);
+    void startThreads(const QString &opts);
+    void stopScan();
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dragMoveEvent(QDragMoveEvent *event) override;
     void dropEvent(QDropEvent *event) override;
@@ -49,6 +52,6 @@ private slots:
     void resetUi();
     void dirChkChange();
     void dumpLogs(const QString &logs, const QColor &col, const LogCode &isErr);
-    void dumpProgress(const float &prog);
+    void drainLogs();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../utils
+
+SOURCES += \
+    tst_batchmanifest.cpp \
+    ../../utils/batchmanifest.cpp
+
+HEADERS += \
+    ../../utils/batchmanifest.h
@@ -0,0 +1,232 @@
+#include "batchmanifest.h"
+
+#include <QtTest>
+
+class TestBatchManifest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void emptyManifest();
+    void resumesUnchangedInput();
+    void changedInputIsRedone();
+    void changedSettingsAreRedone();
+    void damagedOutputIsRedone();
+    void killedMidEncodeIsRedone();
+    void killedReencodeIsRedone();
+    void startedThenFinished();
+    void laterLineWins();
+    void cutShortLineIsSkipped();
+
+private:
+    QString writeFile(const QString &name, const QByteArray &data);
+    void recordOne(const QString &input, const QString &output);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+QString TestBatchManifest::writeFile(const QString &name, const QByteArray &data)
+{
+    const QString path = m_dir->filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString();
+    }
+    file.write(data);
+    return path;
+}
+
+void TestBatchManifest::recordOne(const QString &input, const QString &output)
+{
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    manifest.record(QFileInfo(input), output, QFileInfo(output).size());
+    manifest.close();
+}
+
+void TestBatchManifest::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+}
+
+void TestBatchManifest::emptyManifest()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.isOpen());
+    QVERIFY(!manifest.hadEntries());
+    QVERIFY(!manifest.isRecorded(QFileInfo(input), output));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::resumesUnchangedInput()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.hadEntries());
+    QVERIFY(manifest.isRecorded(QFileInfo(input), output));
+    QVERIFY(manifest.isUpToDate(QFileInfo(input), output));
+
+    // recorded for another output name, e.g. a different suffix
+    QVERIFY(!manifest.isRecorded(QFileInfo(input), m_dir->filePath("a-2.jxl")));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), m_dir->filePath("a-2.jxl")));
+}
+
+void TestBatchManifest::changedInputIsRedone()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    writeFile("a.png", "a bigger png");
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    // still known, just out of date
+    QVERIFY(manifest.isRecorded(QFileInfo(input), output));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::changedSettingsAreRedone()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    BatchManifest otherHash;
+    QVERIFY(otherHash.open(m_dir->path(), "hash2", "cjxl v0.10"));
+    QVERIFY(!otherHash.isUpToDate(QFileInfo(input), output));
+    otherHash.close();
+
+    BatchManifest otherEncoder;
+    QVERIFY(otherEncoder.open(m_dir->path(), "hash1", "cjxl v0.11"));
+    QVERIFY(!otherEncoder.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::damagedOutputIsRedone()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    // half written by a killed run
+    writeFile("a.jxl", "j");
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+    manifest.close();
+
+    QVERIFY(QFile::remove(output));
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::killedMidEncodeIsRedone()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = m_dir->filePath("a.jxl");
+
+    // the first run dies while the encoder is writing straight to the output
+    BatchManifest first;
+    QVERIFY(first.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    first.markStarted(QFileInfo(input), output);
+    writeFile("a.jxl", "half a jxl");
+    first.close();
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.hadEntries());
+    // known, so the leftover isn't mistaken for someone else's file, but never done
+    QVERIFY(manifest.isRecorded(QFileInfo(input), output));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::killedReencodeIsRedone()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    // an overwriting run starts on it again and is killed halfway
+    BatchManifest second;
+    QVERIFY(second.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    second.markStarted(QFileInfo(input), output);
+    // cut off at exactly the old size, the size check alone can't tell
+    writeFile("a.jxl", "JXL");
+    second.close();
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.isRecorded(QFileInfo(input), output));
+    QVERIFY(!manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::startedThenFinished()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = m_dir->filePath("a.jxl");
+
+    BatchManifest first;
+    QVERIFY(first.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    first.markStarted(QFileInfo(input), output);
+    QVERIFY(!first.isUpToDate(QFileInfo(input), output));
+    writeFile("a.jxl", "jxl");
+    first.record(QFileInfo(input), output, QFileInfo(output).size());
+    QVERIFY(first.isUpToDate(QFileInfo(input), output));
+    first.close();
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::laterLineWins()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    recordOne(input, output);
+
+    writeFile("a.jxl", "jxl, encoded again");
+    recordOne(input, output);
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.isUpToDate(QFileInfo(input), output));
+}
+
+void TestBatchManifest::cutShortLineIsSkipped()
+{
+    const QString input = writeFile("a.png", "png");
+    const QString output = writeFile("a.jxl", "jxl");
+    const QString other = writeFile("b.png", "other png");
+    const QString otherOut = writeFile("b.jxl", "other jxl");
+    recordOne(input, output);
+
+    // a kill in the middle of the next line
+    QFile file(m_dir->filePath(BatchManifest::fileName()));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    file.write("{\"input\":\"/half");
+    file.close();
+
+    recordOne(other, otherOut);
+
+    BatchManifest manifest;
+    QVERIFY(manifest.open(m_dir->path(), "hash1", "cjxl v0.10"));
+    QVERIFY(manifest.isUpToDate(QFileInfo(input), output));
+    // written after the broken line, not glued onto it
+    QVERIFY(manifest.isUpToDate(QFileInfo(other), otherOut));
+}
+
+QTEST_GUILESS_MAIN(TestBatchManifest)
+
+#include "tst_batchmanifest.moc"
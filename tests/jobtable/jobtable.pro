@@ -0,0 +1,18 @@
+QT += testlib
+
+CONFIG += qt console warn_on depend_includepath testcase c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../.. ../../utils
+
+SOURCES += \
+    tst_jobtable.cpp \
+    ../../utils/jobtable.cpp \
+    ../../utils/outputdircache.cpp
+
+HEADERS += \
+    ../../logcodes.h \
+    ../../utils/jobtable.h \
+    ../../utils/outputdircache.h
@@ -0,0 +1,148 @@
+#include "jobtable.h"
+#include "outputdircache.h"
+
+#include <QtTest>
+
+class TestJobTable : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void pathsRoundTrip();
+    void appendKeepsIndices();
+    void fileWithoutFolder();
+    void statusRoundTrip();
+    void inputSizeIsClamped();
+    void statusAndSizeShareAWord();
+    void outputDirFor();
+};
+
+void TestJobTable::pathsRoundTrip()
+{
+    const QStringList paths = {"/in/a.png",
+                               "/in/b.jpg",
+                               "/in/sub/c.png",
+                               "/in/a.png",
+                               QString::fromUtf8("/in/ünï/čödé 漢字.png"),
+                               "/in/sub/with space, and comma.gif"};
+    JobTable table;
+    table.append(paths);
+    QCOMPARE(table.size(), paths.size());
+
+    for (int i = 0; i < paths.size(); i++) {
+        QCOMPARE(table.path(i), paths.at(i));
+        QCOMPARE(table.fileName(i), QFileInfo(paths.at(i)).fileName());
+        QCOMPARE(table.dir(i), QFileInfo(paths.at(i)).path());
+    }
+}
+
+void TestJobTable::appendKeepsIndices()
+{
+    // the scan appends a folder at a time, a job's index never moves
+    JobTable table;
+    table.append({"/in/a/1.png", "/in/a/2.png"});
+    table.append({});
+    table.append({"/in/b/3.png"});
+    table.append({"/in/a/4.png"});
+
+    QCOMPARE(table.size(), 4);
+    QCOMPARE(table.path(0), QString("/in/a/1.png"));
+    QCOMPARE(table.path(1), QString("/in/a/2.png"));
+    QCOMPARE(table.path(2), QString("/in/b/3.png"));
+    QCOMPARE(table.path(3), QString("/in/a/4.png"));
+    QCOMPARE(table.dir(3), table.dir(0));
+}
+
+void TestJobTable::fileWithoutFolder()
+{
+    JobTable table;
+    table.append({"a.png"});
+    QCOMPARE(table.path(0), QString("a.png"));
+    QCOMPARE(table.fileName(0), QString("a.png"));
+    QVERIFY(table.dir(0).isEmpty());
+}
+
+void TestJobTable::statusRoundTrip()
+{
+    JobTable table;
+    QStringList paths;
+    for (int i = 0; i < LogCodeCount; i++) {
+        paths.append(QString("/in/%1.png").arg(i));
+    }
+    table.append(paths);
+
+    for (int i = 0; i < LogCodeCount; i++) {
+        // nothing recorded yet
+        QCOMPARE(static_cast<int>(table.status(i)), 0);
+        table.setStatus(i, static_cast<LogCode>(1 << i));
+    }
+    for (int i = 0; i < LogCodeCount; i++) {
+        QCOMPARE(table.status(i), static_cast<LogCode>(1 << i));
+    }
+
+    // a retried file ends up with its last result
+    table.setStatus(0, LogCode::ENCODE_ERR_SKIP);
+    table.setStatus(0, LogCode::OK);
+    QCOMPARE(table.status(0), LogCode::OK);
+}
+
+void TestJobTable::inputSizeIsClamped()
+{
+    JobTable table;
+    table.append({"/in/a.png", "/in/b.png", "/in/c.png", "/in/d.png"});
+
+    QCOMPARE(table.inputSize(0), Q_INT64_C(0));
+
+    table.setInputSize(0, Q_INT64_C(123456789012));
+    QCOMPARE(table.inputSize(0), Q_INT64_C(123456789012));
+
+    // 40 bits, a terabyte input still fits
+    const qint64 maxSize = (Q_INT64_C(1) << 40) - 1;
+    table.setInputSize(1, maxSize);
+    QCOMPARE(table.inputSize(1), maxSize);
+    table.setInputSize(2, maxSize + 1000);
+    QCOMPARE(table.inputSize(2), maxSize);
+
+    // the reports use -1 for "unknown", stored as nothing
+    table.setInputSize(3, -1);
+    QCOMPARE(table.inputSize(3), Q_INT64_C(0));
+}
+
+void TestJobTable::statusAndSizeShareAWord()
+{
+    JobTable table;
+    table.append({"/in/a.png"});
+
+    table.setInputSize(0, (Q_INT64_C(1) << 40) - 1);
+    table.setStatus(0, LogCode::ABORTED);
+    QCOMPARE(table.inputSize(0), (Q_INT64_C(1) << 40) - 1);
+    QCOMPARE(table.status(0), LogCode::ABORTED);
+
+    table.setInputSize(0, 1);
+    QCOMPARE(table.status(0), LogCode::ABORTED);
+    QCOMPARE(table.path(0), QString("/in/a.png"));
+}
+
+void TestJobTable::outputDirFor()
+{
+    JobTable table;
+    table.append({"/in/a.png", "/in/sub/b.png", "/in/sub/deeper/c.png", "/in/sub/d.png"});
+
+    const OutputDirCache mirrored("/out", "/in");
+    QCOMPARE(table.outputDirFor(0, mirrored), QString("/out"));
+    QCOMPARE(table.outputDirFor(1, mirrored), QString("/out/sub"));
+    QCOMPARE(table.outputDirFor(2, mirrored), QString("/out/sub/deeper"));
+    QCOMPARE(table.outputDirFor(3, mirrored), QString("/out/sub"));
+
+    // worked out once per folder, a later cache doesn't change it
+    const OutputDirCache flat("/elsewhere");
+    QCOMPARE(table.outputDirFor(1, flat), QString("/out/sub"));
+
+    JobTable fresh;
+    fresh.append({"/in/sub/b.png"});
+    QCOMPARE(fresh.outputDirFor(0, flat), QString("/elsewhere"));
+}
+
+QTEST_APPLESS_MAIN(TestJobTable)
+
+#include "tst_jobtable.moc"
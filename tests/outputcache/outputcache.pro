@@ -0,0 +1,18 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../utils
+
+SOURCES += \
+    tst_outputcache.cpp \
+    ../../utils/filecopy.cpp \
+    ../../utils/outputcache.cpp
+
+HEADERS += \
+    ../../utils/filecopy.h \
+    ../../utils/outputcache.h
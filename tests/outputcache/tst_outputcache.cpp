@@ -0,0 +1,147 @@
+#include "outputcache.h"
+
+#include <QtTest>
+
+class TestOutputCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void keyIsStable();
+    void keyCoversSettings();
+    void noHashNoKey();
+    void storeAndFetch();
+    void entriesSurviveReopen();
+    void trimsToLimit();
+
+private:
+    static QString writeFile(const QString &path, const QByteArray &data);
+    static QByteArray readFile(const QString &path);
+};
+
+namespace
+{
+const QByteArray contentA = QCryptographicHash::hash("image a", QCryptographicHash::Blake2b_256);
+const QByteArray contentB = QCryptographicHash::hash("image b", QCryptographicHash::Blake2b_256);
+} // namespace
+
+QString TestOutputCache::writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString();
+    }
+    file.write(data);
+    return path;
+}
+
+QByteArray TestOutputCache::readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+void TestOutputCache::keyIsStable()
+{
+    const QByteArray key = OutputCache::key(contentA, "cjxl v0.10", "hash1", ".jxl");
+    QCOMPARE(key, OutputCache::key(contentA, "cjxl v0.10", "hash1", ".jxl"));
+    // hex, so it can be a file name as it is
+    QCOMPARE(key.size(), 64);
+    QVERIFY(QRegularExpression("^[0-9a-f]+$").match(QString::fromLatin1(key)).hasMatch());
+    // the extension is compared like the filesystem would on Windows
+    QCOMPARE(key, OutputCache::key(contentA, "cjxl v0.10", "hash1", ".JXL"));
+}
+
+void TestOutputCache::keyCoversSettings()
+{
+    const QByteArray key = OutputCache::key(contentA, "cjxl v0.10", "hash1", ".jxl");
+    QVERIFY(key != OutputCache::key(contentB, "cjxl v0.10", "hash1", ".jxl"));
+    QVERIFY(key != OutputCache::key(contentA, "cjxl v0.11", "hash1", ".jxl"));
+    QVERIFY(key != OutputCache::key(contentA, "cjxl v0.10", "hash2", ".jxl"));
+    QVERIFY(key != OutputCache::key(contentA, "cjxl v0.10", "hash1", ".png"));
+    // the fields are kept apart, shifting text from one to the next makes another key
+    QVERIFY(OutputCache::key(contentA, "ab", "c", ".jxl") != OutputCache::key(contentA, "a", "bc", ".jxl"));
+}
+
+void TestOutputCache::noHashNoKey()
+{
+    // an input that couldn't be read is never cached
+    QVERIFY(OutputCache::key(QByteArray(), "cjxl v0.10", "hash1", ".jxl").isEmpty());
+}
+
+void TestOutputCache::storeAndFetch()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString source = writeFile(dir.filePath("a.jxl"), QByteArray(1000, 'x'));
+
+    OutputCache cache;
+    QVERIFY(!cache.isOpen());
+    QVERIFY(cache.open(dir.filePath("cache"), 1024 * 1024));
+    QVERIFY(cache.isOpen());
+
+    const QByteArray key = OutputCache::key(contentA, "cjxl v0.10", "hash1", ".jxl");
+    QVERIFY(!cache.fetch(key, dir.filePath("miss.jxl")).success);
+    QVERIFY(!QFile::exists(dir.filePath("miss.jxl")));
+
+    QVERIFY(cache.store(key, source).success);
+    // already there, nothing to do
+    QVERIFY(!cache.store(key, source).success);
+
+    QVERIFY(cache.fetch(key, dir.filePath("b.jxl")).success);
+    QCOMPARE(readFile(dir.filePath("b.jxl")), readFile(source));
+}
+
+void TestOutputCache::entriesSurviveReopen()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString source = writeFile(dir.filePath("a.jxl"), QByteArray(1000, 'x'));
+    const QByteArray key = OutputCache::key(contentA, "cjxl v0.10", "hash1", ".jxl");
+
+    OutputCache cache;
+    QVERIFY(cache.open(dir.filePath("cache"), 1024 * 1024));
+    QVERIFY(cache.store(key, source).success);
+    cache.close();
+    QVERIFY(!cache.isOpen());
+
+    OutputCache again;
+    QVERIFY(again.open(dir.filePath("cache"), 1024 * 1024));
+    QVERIFY(again.fetch(key, dir.filePath("b.jxl")).success);
+    QCOMPARE(readFile(dir.filePath("b.jxl")), readFile(source));
+}
+
+void TestOutputCache::trimsToLimit()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // each entry a fifth of the limit, the oldest go once it's passed
+    const qint64 limit = 10000;
+    OutputCache cache;
+    QVERIFY(cache.open(dir.filePath("cache"), limit));
+
+    QList<QByteArray> keys;
+    for (int i = 0; i < 8; i++) {
+        const QString source = writeFile(dir.filePath(QString("%1.jxl").arg(i)), QByteArray(2000, 'a' + i));
+        const QByteArray content = QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Blake2b_256);
+        keys.append(OutputCache::key(content, "cjxl v0.10", "hash1", ".jxl"));
+        QVERIFY(cache.store(keys.last(), source).success);
+        // lastUse has millisecond resolution, keep the order unambiguous
+        QTest::qWait(5);
+    }
+
+    QVERIFY(!cache.fetch(keys.first(), dir.filePath("first.jxl")).success);
+    QVERIFY(cache.fetch(keys.last(), dir.filePath("last.jxl")).success);
+
+    // one bigger than a quarter of the cache is never stored
+    const QString huge = writeFile(dir.filePath("huge.jxl"), QByteArray(limit / 2, 'z'));
+    QVERIFY(!cache.store(OutputCache::key(contentB, "cjxl v0.10", "hash1", ".jxl"), huge).success);
+}
+
+QTEST_GUILESS_MAIN(TestOutputCache)
+
+#include "tst_outputcache.moc"
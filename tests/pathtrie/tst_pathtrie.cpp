@@ -0,0 +1,90 @@
+#include "pathtrie.h"
+
+#include <QtTest>
+
+class TestPathTrie : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyCoversNothing();
+    void coversFolderAndBelow();
+    void siblingWithSamePrefix();
+    void parentIsNotCovered();
+    void pathsAreCleaned();
+    void caseSensitive();
+};
+
+void TestPathTrie::emptyCoversNothing()
+{
+    PathTrie trie;
+    QVERIFY(trie.isEmpty());
+    QVERIFY(!trie.covers("/"));
+    QVERIFY(!trie.covers("/photos/a.png"));
+
+    // nothing to key on, stays empty
+    trie.insert(QString());
+    trie.insert("/");
+    QVERIFY(trie.isEmpty());
+}
+
+void TestPathTrie::coversFolderAndBelow()
+{
+    PathTrie trie;
+    trie.insert("/photos/raw");
+    QVERIFY(!trie.isEmpty());
+
+    QVERIFY(trie.covers("/photos/raw"));
+    QVERIFY(trie.covers("/photos/raw/a.png"));
+    QVERIFY(trie.covers("/photos/raw/2023/06/b.png"));
+    QVERIFY(!trie.covers("/photos/edited/a.png"));
+    QVERIFY(!trie.covers("/other/raw/a.png"));
+}
+
+void TestPathTrie::siblingWithSamePrefix()
+{
+    // components are compared whole, not as string prefixes
+    PathTrie trie;
+    trie.insert("/photos/raw");
+    QVERIFY(!trie.covers("/photos/raw2"));
+    QVERIFY(!trie.covers("/photos/raw2/a.png"));
+    QVERIFY(!trie.covers("/photos/ra"));
+}
+
+void TestPathTrie::parentIsNotCovered()
+{
+    PathTrie trie;
+    trie.insert("/photos/raw/2023");
+    trie.insert("/photos/tmp");
+    QVERIFY(!trie.covers("/photos"));
+    QVERIFY(!trie.covers("/photos/raw"));
+    QVERIFY(!trie.covers("/photos/raw/a.png"));
+    QVERIFY(trie.covers("/photos/raw/2023/a.png"));
+    QVERIFY(trie.covers("/photos/tmp/a.png"));
+
+    // a shorter folder added later covers what's under the longer one too
+    trie.insert("/photos/raw");
+    QVERIFY(trie.covers("/photos/raw/a.png"));
+}
+
+void TestPathTrie::pathsAreCleaned()
+{
+    PathTrie trie;
+    trie.insert("/photos//raw/");
+    QVERIFY(trie.covers("/photos/raw/a.png"));
+    QVERIFY(trie.covers("/photos/./raw/a.png"));
+    QVERIFY(trie.covers("/photos/edited/../raw/a.png"));
+    QVERIFY(!trie.covers("/photos/raw/../edited/a.png"));
+}
+
+void TestPathTrie::caseSensitive()
+{
+    PathTrie trie;
+    trie.insert("/Photos/Raw");
+    QVERIFY(trie.covers("/Photos/Raw/a.png"));
+    QVERIFY(!trie.covers("/photos/raw/a.png"));
+}
+
+QTEST_APPLESS_MAIN(TestPathTrie)
+
+#include "tst_pathtrie.moc"
@@ -0,0 +1,18 @@
+QT += testlib
+
+CONFIG += qt console warn_on depend_includepath testcase c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../.. ../../utils
+
+SOURCES += \
+    tst_runreport.cpp \
+    ../../utils/logfilewriter.cpp \
+    ../../utils/runreport.cpp
+
+HEADERS += \
+    ../../logcodes.h \
+    ../../utils/logfilewriter.h \
+    ../../utils/runreport.h
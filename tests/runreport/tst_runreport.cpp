@@ -0,0 +1,225 @@
+#include "runreport.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace
+{
+// just enough of RFC 4180 to read back what the report writes
+QList<QStringList> parseCsv(const QString &text)
+{
+    QList<QStringList> records;
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int i = 0; i < text.size(); i++) {
+        const QChar c = text.at(i);
+        if (quoted) {
+            if (c == '"' && i + 1 < text.size() && text.at(i + 1) == '"') {
+                field.append('"');
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field.append(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.append(field);
+            field.clear();
+        } else if (c == '\n') {
+            fields.append(field);
+            field.clear();
+            records.append(fields);
+            fields.clear();
+        } else {
+            field.append(c);
+        }
+    }
+    return records;
+}
+
+QString readAll(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll());
+}
+} // namespace
+
+class TestRunReport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void csvHeader();
+    void csvQuoting_data();
+    void csvQuoting();
+    void jsonlRows();
+    void neverOverwrites();
+};
+
+void TestRunReport::csvHeader()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    RunReport report;
+    QVERIFY(report.open(dir.path(), RunReport::Format::Csv, "abc123", "cjxl v0.10"));
+    QVERIFY(report.isOpen());
+    QVERIFY(report.filePath().endsWith(".csv"));
+    QVERIFY(QFileInfo(report.filePath()).fileName().startsWith("jxl-batch-report-"));
+    report.close();
+    QVERIFY(!report.isOpen());
+
+    const QList<QStringList> records = parseCsv(readAll(report.filePath()));
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records.at(0).join(','),
+             QString("finished,input,output,input_size,output_size,encode_hash,encoder,backend,exit_code,log_code,wall_ms,mps,timed_out,aborted"));
+}
+
+void TestRunReport::csvQuoting_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QString>("encoder");
+    QTest::addColumn<QString>("backend");
+
+    QTest::newRow("plain") << "/in/a.png" << "cjxl" << "cjxl";
+    QTest::newRow("comma") << "/in/a, b.png" << "cjxl" << "cjxl";
+    QTest::newRow("quotes") << "/in/\"quoted\".png" << "cjxl \"dev\"" << "cjxl";
+    QTest::newRow("newline") << "/in/line\nbreak.png" << "cjxl" << "cjxl";
+    QTest::newRow("carriage return") << "/in/cr\r.png" << "cjxl" << "cjxl";
+    QTest::newRow("everything") << "/in/\"a\",\nb\r\n.png" << "lib,jxl" << "in-process, libjxl";
+    QTest::newRow("unicode") << QString::fromUtf8("/in/čödé 漢字.png") << "cjxl" << "cjxl";
+}
+
+void TestRunReport::csvQuoting()
+{
+    QFETCH(QString, input);
+    QFETCH(QString, encoder);
+    QFETCH(QString, backend);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    RunReport report;
+    QVERIFY(report.open(dir.path(), RunReport::Format::Csv, "hash,with\"stuff", encoder));
+
+    RunReport::Row row;
+    row.input = input;
+    row.output = input + ".jxl";
+    row.backend = backend;
+    row.inputSize = 1234;
+    row.outputSize = 567;
+    row.wallMs = 89;
+    row.mps = 1.23456;
+    row.exitCode = 0;
+    row.code = LogCode::OK;
+    report.record(row);
+
+    RunReport::Row skipped;
+    skipped.input = "/in/skipped.png";
+    skipped.code = LogCode::SKIPPED_ALREADY_EXIST;
+    skipped.aborted = true;
+    report.record(skipped);
+    report.close();
+
+    const QList<QStringList> records = parseCsv(readAll(report.filePath()));
+    QCOMPARE(records.size(), 3);
+
+    const QStringList header = records.at(0);
+    const QStringList first = records.at(1);
+    QCOMPARE(first.size(), header.size());
+    QCOMPARE(first.at(header.indexOf("input")), input);
+    QCOMPARE(first.at(header.indexOf("output")), input + ".jxl");
+    QCOMPARE(first.at(header.indexOf("input_size")), QString("1234"));
+    QCOMPARE(first.at(header.indexOf("output_size")), QString("567"));
+    QCOMPARE(first.at(header.indexOf("encode_hash")), QString("hash,with\"stuff"));
+    QCOMPARE(first.at(header.indexOf("encoder")), encoder);
+    QCOMPARE(first.at(header.indexOf("backend")), backend);
+    QCOMPARE(first.at(header.indexOf("exit_code")), QString("0"));
+    QCOMPARE(first.at(header.indexOf("log_code")), QString("OK"));
+    QCOMPARE(first.at(header.indexOf("wall_ms")), QString("89"));
+    QCOMPARE(first.at(header.indexOf("mps")), QString("1.235"));
+    QCOMPARE(first.at(header.indexOf("timed_out")), QString("0"));
+    QCOMPARE(first.at(header.indexOf("aborted")), QString("0"));
+
+    // what doesn't apply stays -1
+    const QStringList second = records.at(2);
+    QCOMPARE(second.size(), header.size());
+    QCOMPARE(second.at(header.indexOf("input")), QString("/in/skipped.png"));
+    QVERIFY(second.at(header.indexOf("output")).isEmpty());
+    QCOMPARE(second.at(header.indexOf("input_size")), QString("-1"));
+    QCOMPARE(second.at(header.indexOf("exit_code")), QString("-1"));
+    QCOMPARE(second.at(header.indexOf("mps")), QString("-1"));
+    QCOMPARE(second.at(header.indexOf("log_code")), QString("SKIPPED_ALREADY_EXIST"));
+    QCOMPARE(second.at(header.indexOf("aborted")), QString("1"));
+}
+
+void TestRunReport::jsonlRows()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    RunReport report;
+    QVERIFY(report.open(dir.path(), RunReport::Format::Jsonl, "abc123", "cjxl"));
+    QVERIFY(report.filePath().endsWith(".jsonl"));
+
+    RunReport::Row row;
+    row.input = "/in/\"a\",\nb.png";
+    row.output = "/out/a.jxl";
+    row.backend = "cjxl";
+    row.inputSize = 1234;
+    row.mps = 2.0;
+    row.code = LogCode::ENCODE_ERR_COPY;
+    row.timedOut = true;
+    report.record(row);
+    report.record(RunReport::Row());
+    report.close();
+
+    const QStringList lines = readAll(report.filePath()).split('\n', Qt::SkipEmptyParts);
+    QCOMPARE(lines.size(), 2);
+
+    QJsonParseError error;
+    const QJsonObject obj = QJsonDocument::fromJson(lines.at(0).toUtf8(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(obj.value("input").toString(), row.input);
+    QCOMPARE(obj.value("output").toString(), row.output);
+    QCOMPARE(obj.value("inputSize").toDouble(), 1234.0);
+    QCOMPARE(obj.value("outputSize").toDouble(), -1.0);
+    QCOMPARE(obj.value("encodeHash").toString(), QString("abc123"));
+    QCOMPARE(obj.value("logCode").toString(), QString("ENCODE_ERR_COPY"));
+    QCOMPARE(obj.value("mps").toDouble(), 2.0);
+    QCOMPARE(obj.value("timedOut").toBool(), true);
+    QCOMPARE(obj.value("aborted").toBool(), false);
+
+    QVERIFY(!QJsonDocument::fromJson(lines.at(1).toUtf8(), &error).isNull());
+    QCOMPARE(error.error, QJsonParseError::NoError);
+}
+
+void TestRunReport::neverOverwrites()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // two runs within the same second each get a file of their own
+    RunReport first;
+    RunReport second;
+    QVERIFY(first.open(dir.path(), RunReport::Format::Csv, QString(), QString()));
+    QVERIFY(second.open(dir.path(), RunReport::Format::Csv, QString(), QString()));
+    QVERIFY(first.filePath() != second.filePath());
+
+    // nothing recorded while closed
+    first.close();
+    first.record(RunReport::Row());
+    QCOMPARE(parseCsv(readAll(first.filePath())).size(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestRunReport)
+
+#include "tst_runreport.moc"
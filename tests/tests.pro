@@ -0,0 +1,10 @@
+# unit tests for the pure-logic parts under utils/, run with "qmake && make check"
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    batchmanifest \
+    jobtable \
+    outputcache \
+    pathtrie \
+    runreport \
+    workerprotocol
@@ -0,0 +1,110 @@
+#include "workerprotocol.h"
+
+#include <QtTest>
+
+class TestWorkerProtocol : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void jobRoundTrip();
+    void jobIsOneLine();
+    void jobNeedsPaths();
+    void replyRoundTrip();
+    void replyDefaultsToFailure();
+    void garbageIsRejected();
+};
+
+void TestWorkerProtocol::jobRoundTrip()
+{
+    WorkerJob job;
+    job.id = 42;
+    job.decode = true;
+    job.threads = 3;
+    job.input = QString::fromUtf8("/in/ünïcode, \"quoted\".png");
+    job.output = QString("/out/a.jxl");
+    job.options.insert("effort", "7");
+    job.options.insert("distance", "1.0");
+
+    WorkerJob back;
+    QVERIFY(WorkerJob::fromLine(job.toLine(), back));
+    QCOMPARE(back.id, job.id);
+    QCOMPARE(back.decode, job.decode);
+    QCOMPARE(back.threads, job.threads);
+    QCOMPARE(back.input, job.input);
+    QCOMPARE(back.output, job.output);
+    QCOMPARE(back.options, job.options);
+}
+
+void TestWorkerProtocol::jobIsOneLine()
+{
+    // the reader splits on newlines, one inside a path must stay escaped
+    WorkerJob job;
+    job.input = QString("/in/two\nlines.png");
+    job.output = QString("/out/two\nlines.jxl");
+
+    const QByteArray line = job.toLine();
+    QVERIFY(line.endsWith('\n'));
+    QCOMPARE(line.count('\n'), 1);
+
+    WorkerJob back;
+    QVERIFY(WorkerJob::fromLine(line, back));
+    QCOMPARE(back.input, job.input);
+}
+
+void TestWorkerProtocol::jobNeedsPaths()
+{
+    WorkerJob job;
+    job.input = QString("/in/a.png");
+
+    WorkerJob back;
+    QVERIFY(!WorkerJob::fromLine(job.toLine(), back));
+}
+
+void TestWorkerProtocol::replyRoundTrip()
+{
+    WorkerReply reply;
+    reply.id = 7;
+    reply.exitCode = 0;
+    reply.needsBinary = true;
+    reply.log = QString("Encoded\nsecond line");
+    reply.pixels = Q_INT64_C(12000000000);
+    reply.outputBytes = Q_INT64_C(5000000000);
+    reply.wallMs = 1234;
+    reply.peakRss = Q_INT64_C(3000000000);
+    reply.mps = 12.5;
+
+    WorkerReply back;
+    QVERIFY(WorkerReply::fromLine(reply.toLine(), back));
+    QCOMPARE(back.id, reply.id);
+    QCOMPARE(back.exitCode, reply.exitCode);
+    QCOMPARE(back.needsBinary, reply.needsBinary);
+    QCOMPARE(back.log, reply.log);
+    QCOMPARE(back.pixels, reply.pixels);
+    QCOMPARE(back.outputBytes, reply.outputBytes);
+    QCOMPARE(back.wallMs, reply.wallMs);
+    QCOMPARE(back.peakRss, reply.peakRss);
+    QCOMPARE(back.mps, reply.mps);
+}
+
+void TestWorkerProtocol::replyDefaultsToFailure()
+{
+    // a reply without an exit code must not pass for a success
+    WorkerReply back;
+    QVERIFY(WorkerReply::fromLine(QByteArray("{\"id\":1}\n"), back));
+    QCOMPARE(back.id, 1);
+    QCOMPARE(back.exitCode, 1);
+}
+
+void TestWorkerProtocol::garbageIsRejected()
+{
+    WorkerJob job;
+    WorkerReply reply;
+    QVERIFY(!WorkerJob::fromLine(QByteArray("not json\n"), job));
+    QVERIFY(!WorkerReply::fromLine(QByteArray("[1,2,3]\n"), reply));
+    QVERIFY(!WorkerReply::fromLine(QByteArray(), reply));
+}
+
+QTEST_APPLESS_MAIN(TestWorkerProtocol)
+
+#include "tst_workerprotocol.moc"
@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase c++17
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += ../../utils
+
+SOURCES += \
+    tst_workerprotocol.cpp \
+    ../../utils/workerprotocol.cpp
+
+HEADERS += \
+    ../../utils/workerprotocol.h
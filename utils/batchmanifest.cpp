@@ -0,0 +1,191 @@
+#include "batchmanifest.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace
+{
+QByteArray entryLine(const QString &input,
+                     qint64 size,
+                     qint64 mtime,
+                     const QString &hash,
+                     const QString &encoder,
+                     const QString &output,
+                     qint64 outputSize,
+                     bool done)
+{
+    QJsonObject obj;
+    obj.insert("input", input);
+    obj.insert("size", static_cast<double>(size));
+    obj.insert("mtime", static_cast<double>(mtime));
+    obj.insert("hash", hash);
+    obj.insert("encoder", encoder);
+    obj.insert("output", output);
+    obj.insert("outputSize", static_cast<double>(outputSize));
+    if (!done) {
+        obj.insert("done", false);
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+} // namespace
+
+const char *BatchManifest::fileName()
+{
+    return ".jxl-batch-manifest.jsonl";
+}
+
+bool BatchManifest::open(const QString &outputRoot, const QString &encodeHash, const QString &encoder)
+{
+    close();
+
+    m_encodeHash = encodeHash;
+    m_encoder = encoder;
+    m_file.setFileName(QDir::cleanPath(outputRoot + QDir::separator() + QString(fileName())));
+
+    bool cutShort = false;
+    if (m_file.open(QIODevice::ReadOnly)) {
+        while (!m_file.atEnd()) {
+            const QByteArray line = m_file.readLine();
+            cutShort = !line.endsWith('\n');
+            const QJsonObject obj = QJsonDocument::fromJson(line).object();
+            const QString input = obj.value("input").toString();
+            // a line cut short by a kill just doesn't parse, that file gets redone
+            if (input.isEmpty()) {
+                continue;
+            }
+            Entry entry;
+            entry.size = static_cast<qint64>(obj.value("size").toDouble());
+            entry.mtime = static_cast<qint64>(obj.value("mtime").toDouble());
+            entry.outputSize = static_cast<qint64>(obj.value("outputSize").toDouble());
+            entry.hash = obj.value("hash").toString();
+            entry.encoder = obj.value("encoder").toString();
+            entry.output = obj.value("output").toString();
+            // lines without it are from before the started lines
+            entry.done = obj.value("done").toBool(true);
+            m_entries.insert(input, entry);
+            m_lines++;
+        }
+        m_file.close();
+    }
+
+    // superseded lines pile up over many runs, squeeze them out now and then
+    if (m_lines > 1024 && m_lines > m_entries.size() * 2 && compact()) {
+        cutShort = false;
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    // don't glue the next entry onto a half line
+    if (cutShort) {
+        m_file.write("\n");
+        m_file.flush();
+    }
+    return true;
+}
+
+void BatchManifest::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_entries.clear();
+    m_lines = 0;
+}
+
+bool BatchManifest::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool BatchManifest::hadEntries() const
+{
+    return !m_entries.isEmpty();
+}
+
+bool BatchManifest::isRecorded(const QFileInfo &input, const QString &output) const
+{
+    // written by an earlier run for this input, whether or not it's still current or ever finished
+    const auto it = m_entries.constFind(input.absoluteFilePath());
+    return it != m_entries.constEnd() && it.value().output == output;
+}
+
+bool BatchManifest::isUpToDate(const QFileInfo &input, const QString &output) const
+{
+    const auto it = m_entries.constFind(input.absoluteFilePath());
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    const Entry &entry = it.value();
+    if (!entry.done || entry.size != input.size() || entry.mtime != input.lastModified().toMSecsSinceEpoch()
+        || entry.hash != m_encodeHash || entry.encoder != m_encoder || entry.output != output) {
+        return false;
+    }
+
+    const QFileInfo outFile(output);
+    return outFile.exists() && outFile.size() == entry.outputSize;
+}
+
+void BatchManifest::markStarted(const QFileInfo &input, const QString &output)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    Entry entry;
+    entry.size = input.size();
+    entry.mtime = input.lastModified().toMSecsSinceEpoch();
+    entry.outputSize = -1;
+    entry.hash = m_encodeHash;
+    entry.encoder = m_encoder;
+    entry.output = output;
+    entry.done = false;
+    append(input.absoluteFilePath(), entry);
+}
+
+void BatchManifest::record(const QFileInfo &input, const QString &output, qint64 outputSize)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    Entry entry;
+    entry.size = input.size();
+    entry.mtime = input.lastModified().toMSecsSinceEpoch();
+    entry.outputSize = outputSize;
+    entry.hash = m_encodeHash;
+    entry.encoder = m_encoder;
+    entry.output = output;
+    append(input.absoluteFilePath(), entry);
+}
+
+void BatchManifest::append(const QString &input, const Entry &entry)
+{
+    m_entries.insert(input, entry);
+
+    // flushed per line, a killed run keeps everything that finished before it
+    // and the started line of whatever it was in the middle of
+    m_file.write(entryLine(input, entry.size, entry.mtime, entry.hash, entry.encoder, entry.output, entry.outputSize, entry.done));
+    m_file.flush();
+    m_lines++;
+}
+
+bool BatchManifest::compact()
+{
+    QSaveFile out(m_file.fileName());
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const Entry &entry = it.value();
+        out.write(entryLine(it.key(), entry.size, entry.mtime, entry.hash, entry.encoder, entry.output, entry.outputSize, entry.done));
+    }
+    if (!out.commit()) {
+        return false;
+    }
+    m_lines = m_entries.size();
+    return true;
+}
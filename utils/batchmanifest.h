@@ -0,0 +1,59 @@
+#ifndef BATCHMANIFEST_H
+#define BATCHMANIFEST_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QString>
+
+/*
+ * Record of finished conversions kept in the output root, so a re-run of
+ * the same batch only redoes what's new, changed or failed.
+ *
+ * One JSON line per finished file, appended and flushed right away, a
+ * later line for the same input wins. An input counts as done only if
+ * its size and mtime, the option hash and the encoder all still match
+ * and the output is there with the recorded size, a half-written output
+ * left by a killed run doesn't pass that.
+ *
+ * Before its output is touched an input also gets a "started" line, so
+ * an output whose last line never went past started is known to be the
+ * leftover of a killed run, even with no finished line to compare it to.
+ */
+class BatchManifest
+{
+public:
+    static const char *fileName();
+
+    bool open(const QString &outputRoot, const QString &encodeHash, const QString &encoder);
+    void close();
+    bool isOpen() const;
+    bool hadEntries() const;
+
+    bool isRecorded(const QFileInfo &input, const QString &output) const;
+    bool isUpToDate(const QFileInfo &input, const QString &output) const;
+    void markStarted(const QFileInfo &input, const QString &output);
+    void record(const QFileInfo &input, const QString &output, qint64 outputSize);
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 mtime = 0;
+        qint64 outputSize = 0;
+        QString hash;
+        QString encoder;
+        QString output;
+        bool done = true;
+    };
+
+    void append(const QString &input, const Entry &entry);
+    bool compact();
+
+    QFile m_file;
+    QString m_encodeHash;
+    QString m_encoder;
+    QHash<QString, Entry> m_entries;
+    int m_lines = 0;
+};
+
+#endif // BATCHMANIFEST_H
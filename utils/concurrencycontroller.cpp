@@ -0,0 +1,79 @@
+#include "concurrencycontroller.h"
+
+#include <algorithm>
+
+// shortest window a throughput sample is taken over
+#define WINDOW_MIN_MS 3000
+// relative change that counts as better / worse, anything in between is a plateau
+#define THROUGHPUT_TOLERANCE 0.03
+
+ConcurrencyController::ConcurrencyController()
+{
+    reset(1);
+}
+
+void ConcurrencyController::reset(int maxJobs)
+{
+    m_maxJobs = std::max(maxJobs, 1);
+    m_jobs = 1;
+    m_step = 1;
+    m_lastThroughput = 0.0;
+    m_windowPixels = 0;
+    m_windowSamples = 0;
+    m_window.start();
+}
+
+void ConcurrencyController::setMaxJobs(int maxJobs)
+{
+    m_maxJobs = std::max(maxJobs, 1);
+    m_jobs = std::min(m_jobs, m_maxJobs);
+}
+
+void ConcurrencyController::addSample(qint64 pixels)
+{
+    m_windowPixels += pixels;
+    m_windowSamples++;
+}
+
+bool ConcurrencyController::update()
+{
+    // wait until every running job had the chance to finish at least once
+    const qint64 elapsed = m_window.elapsed();
+    if (elapsed < WINDOW_MIN_MS || m_windowSamples < m_jobs) {
+        return false;
+    }
+
+    const double throughput = static_cast<double>(m_windowPixels) / 1000000.0 / (elapsed / 1000.0);
+    const int oldJobs = m_jobs;
+
+    if (m_lastThroughput <= 0.0 || throughput > m_lastThroughput * (1.0 + THROUGHPUT_TOLERANCE)) {
+        // getting faster, keep going the same way
+        m_jobs += m_step;
+    } else if (throughput < m_lastThroughput * (1.0 - THROUGHPUT_TOLERANCE)) {
+        // getting slower, turn around
+        m_step = -m_step;
+        m_jobs += m_step;
+    }
+    m_jobs = std::max(std::min(m_jobs, m_maxJobs), 1);
+    if (m_jobs == 1 && m_step < 0) {
+        // nothing below one job, next probe goes back up
+        m_step = 1;
+    }
+
+    m_lastThroughput = throughput;
+    m_windowPixels = 0;
+    m_windowSamples = 0;
+    m_window.start();
+
+    return m_jobs != oldJobs;
+}
+
+int ConcurrencyController::jobs() const
+{
+    return m_jobs;
+}
+
+double ConcurrencyController::lastThroughput() const
+{
+    return m_lastThroughput;
+}
@@ -0,0 +1,37 @@
+#ifndef CONCURRENCYCONTROLLER_H
+#define CONCURRENCYCONTROLLER_H
+
+#include <QElapsedTimer>
+
+/*
+ * Hill-climbs the number of concurrent jobs on measured throughput.
+ *
+ * Starts low, keeps adding jobs while the aggregate MP/s goes up and backs
+ * off once it drops (memory pressure, I/O contention, ...).
+ */
+class ConcurrencyController
+{
+public:
+    ConcurrencyController();
+
+    void reset(int maxJobs);
+    void setMaxJobs(int maxJobs);
+    void addSample(qint64 pixels);
+
+    bool update();
+
+    int jobs() const;
+    double lastThroughput() const;
+
+private:
+    QElapsedTimer m_window;
+    qint64 m_windowPixels = 0;
+    int m_windowSamples = 0;
+
+    double m_lastThroughput = 0.0;
+    int m_jobs = 1;
+    int m_maxJobs = 1;
+    int m_step = 1;
+};
+
+#endif // CONCURRENCYCONTROLLER_H
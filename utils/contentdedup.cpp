@@ -0,0 +1,118 @@
+#include "contentdedup.h"
+#include "jobtable.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+void ContentDedup::reset(const QSharedPointer<JobTable> &jobs)
+{
+    m_jobs = jobs;
+    m_byIdentity.clear();
+    m_bySize.clear();
+}
+
+int ContentDedup::match(const QFileInfo &fin, int jobIndex)
+{
+    const QByteArray id = identity(fin);
+    const auto known = m_byIdentity.constFind(id);
+    if (known != m_byIdentity.constEnd()) {
+        return known.value();
+    }
+    m_byIdentity.insert(id, jobIndex);
+
+    m_bySize[fin.size()].append({QByteArray(), jobIndex, false});
+    return -1;
+}
+
+bool ContentDedup::needsHash(const QFileInfo &fin, int jobIndex) const
+{
+    const auto it = m_bySize.constFind(fin.size());
+    if (it == m_bySize.constEnd()) {
+        return false;
+    }
+    for (const Entry &entry : it.value()) {
+        if (entry.jobIndex != jobIndex) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<int> ContentDedup::beginHash(const QFileInfo &fin, int jobIndex)
+{
+    // one that's being hashed for itself compares against this one when it lands,
+    // the rest are only hashed now that there is something to compare with
+    QVector<int> earlier;
+    for (Entry &entry : m_bySize[fin.size()]) {
+        if (entry.jobIndex == jobIndex) {
+            entry.hashing = true;
+        } else if (entry.hash.isEmpty() && !entry.hashing && m_jobs) {
+            earlier.append(entry.jobIndex);
+        }
+    }
+    return earlier;
+}
+
+int ContentDedup::matchHash(const QFileInfo &fin, int jobIndex, const QByteArray &hash, const QHash<int, QByteArray> &earlier)
+{
+    QVector<Entry> &sameSize = m_bySize[fin.size()];
+    int self = -1;
+    for (int i = 0; i < sameSize.size(); i++) {
+        Entry &entry = sameSize[i];
+        if (entry.jobIndex == jobIndex) {
+            entry.hash = hash;
+            entry.hashing = false;
+            self = i;
+        } else if (entry.hash.isEmpty()) {
+            entry.hash = earlier.value(entry.jobIndex);
+        }
+    }
+    if (hash.isEmpty()) {
+        return -1;
+    }
+
+    for (int i = 0; i < sameSize.size(); i++) {
+        const Entry &entry = sameSize.at(i);
+        if (i != self && entry.hash == hash) {
+            const int primary = entry.jobIndex;
+            // a copy isn't something later inputs have to be compared with
+            if (self >= 0) {
+                sameSize.remove(self);
+            }
+            m_byIdentity.insert(identity(fin), primary);
+            return primary;
+        }
+    }
+    return -1;
+}
+
+QByteArray ContentDedup::identity(const QFileInfo &fin)
+{
+#ifdef Q_OS_UNIX
+    // stat follows symlinks, hardlinks share the inode, 16 raw bytes a file
+    struct stat st;
+    if (::stat(QFile::encodeName(fin.absoluteFilePath()).constData(), &st) == 0) {
+        const quint64 key[2] = {static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino)};
+        return QByteArray(reinterpret_cast<const char *>(key), sizeof(key));
+    }
+#endif
+    const QString canonical = fin.canonicalFilePath();
+    return (canonical.isEmpty() ? fin.absoluteFilePath() : canonical).toUtf8();
+}
+
+QByteArray ContentDedup::hashFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    if (!hash.addData(&file)) {
+        return QByteArray();
+    }
+    return hash.result();
+}
@@ -0,0 +1,61 @@
+#ifndef CONTENTDEDUP_H
+#define CONTENTDEDUP_H
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+class JobTable;
+
+/*
+ * Spots inputs that are the same image as one seen earlier in the batch,
+ * so it's encoded once and the others just get a copy of the result.
+ *
+ * The same file reached through a hardlink or a symlink is caught by its
+ * identity (device and inode on Unix, the canonical path elsewhere).
+ * Other files are compared by size first and only hashed when another
+ * input has the same size, a batch without same-sized files reads nothing.
+ *
+ * The hashing itself is left to the caller, off the loop: beginHash()
+ * says which earlier inputs have to be read along with the new one, and
+ * matchHash() takes the results. Inputs are compared once their own hash
+ * is in, so two that finish hashing in any order still find each other.
+ *
+ * Not thread-safe, it lives on ConversionThread's loop.
+ */
+class ContentDedup
+{
+public:
+    // earlier inputs are looked up in the job table when they need hashing
+    void reset(const QSharedPointer<JobTable> &jobs = QSharedPointer<JobTable>());
+
+    // jobIndex of an earlier input that is the very same file, -1 for a new one,
+    // which is entered under its size
+    int match(const QFileInfo &fin, int jobIndex);
+    // another input has the same size, the content has to be compared
+    bool needsHash(const QFileInfo &fin, int jobIndex) const;
+    // earlier same-sized inputs nobody is hashing, to be hashed along with this one
+    QVector<int> beginHash(const QFileInfo &fin, int jobIndex);
+    // jobIndex of the first input with the same content, -1 for a new one
+    int matchHash(const QFileInfo &fin, int jobIndex, const QByteArray &hash, const QHash<int, QByteArray> &earlier);
+
+    static QByteArray hashFile(const QString &path);
+
+private:
+    struct Entry {
+        QByteArray hash;
+        int jobIndex = 0;
+        bool hashing = false;
+    };
+
+    static QByteArray identity(const QFileInfo &fin);
+
+    QSharedPointer<JobTable> m_jobs;
+    QHash<QByteArray, int> m_byIdentity;
+    QHash<qint64, QVector<Entry>> m_bySize;
+};
+
+#endif // CONTENTDEDUP_H
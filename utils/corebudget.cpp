@@ -0,0 +1,47 @@
+#include "corebudget.h"
+
+#include <algorithm>
+
+// roughly how many pixels one thread can chew through efficiently
+#define PIXELS_PER_THREAD (2 * 1000 * 1000)
+
+CoreBudget::CoreBudget(int cores)
+{
+    setCores(cores);
+}
+
+void CoreBudget::setCores(int cores)
+{
+    m_cores = std::max(cores, 1);
+}
+
+int CoreBudget::cores() const
+{
+    return m_cores;
+}
+
+int CoreBudget::available() const
+{
+    return std::max(m_cores - m_inUse, 0);
+}
+
+int CoreBudget::acquire(qint64 pixels, int jobsInFlight)
+{
+    const int free = available();
+    if (free < 1) {
+        // caller has to wait for a running job to give its cores back
+        return 0;
+    }
+
+    const int wanted = static_cast<int>(std::min<qint64>(std::max<qint64>(pixels / PIXELS_PER_THREAD, 1), m_cores));
+    const int share = std::max(m_cores / std::max(jobsInFlight + 1, 1), 1);
+    const int granted = std::max(std::min({wanted, share, free}), 1);
+
+    m_inUse += granted;
+    return granted;
+}
+
+void CoreBudget::release(int threads)
+{
+    m_inUse = std::max(m_inUse - threads, 0);
+}
@@ -0,0 +1,29 @@
+#ifndef COREBUDGET_H
+#define COREBUDGET_H
+
+#include <QtGlobal>
+
+/*
+ * Splits a fixed number of CPU cores between the processes in flight.
+ *
+ * Big images get several threads, small ones get one so many of them can
+ * run side by side, and the sum of granted threads never exceeds the budget.
+ */
+class CoreBudget
+{
+public:
+    explicit CoreBudget(int cores = 1);
+
+    void setCores(int cores);
+    int cores() const;
+    int available() const;
+
+    int acquire(qint64 pixels, int jobsInFlight);
+    void release(int threads);
+
+private:
+    int m_cores = 1;
+    int m_inUse = 0;
+};
+
+#endif // COREBUDGET_H
@@ -0,0 +1,189 @@
+#include "dircrawler.h"
+#include "pathtrie.h"
+
+#include <QDirIterator>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+
+struct Q_DECL_HIDDEN DirCrawler::Private
+{
+    QString root;
+    QStringList nameFilters;
+    QDir::Filters dirFilters;
+    bool recursive = true;
+    PathTrie excluded;
+    BatchHandler handler;
+    BatchHandler otherHandler;
+
+    QThreadPool pool;
+    QMutex mutex;
+    QWaitCondition done;
+    QStringList files;
+    int pending = 0;
+    int folders = 0;
+    int foldersExcluded = 0;
+    bool stopped = false;
+};
+
+DirCrawler::DirCrawler(const QString &root, const QStringList &nameFilters, bool includeHidden, bool recursive)
+    : d(new Private)
+{
+    d->root = root;
+    d->nameFilters = nameFilters;
+    // AllDirs keeps folders out of the name filters, Hidden applies to both
+    d->dirFilters = QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot;
+    if (includeHidden) {
+        d->dirFilters |= QDir::Hidden;
+    }
+    d->recursive = recursive;
+
+    // listings mostly wait on the disk or the network, not the CPU
+    setMaxOutstanding(qBound(4, QThread::idealThreadCount() * 2, 32));
+}
+
+DirCrawler::~DirCrawler()
+{
+    d->pool.waitForDone();
+}
+
+void DirCrawler::setExcludedFolders(const QStringList &folders)
+{
+    d->excluded = PathTrie();
+    for (const QString &folder : folders) {
+        d->excluded.insert(folder);
+    }
+}
+
+void DirCrawler::setBatchHandler(const BatchHandler &handler)
+{
+    d->handler = handler;
+}
+
+void DirCrawler::setOtherFilesHandler(const BatchHandler &handler)
+{
+    d->otherHandler = handler;
+}
+
+void DirCrawler::setMaxOutstanding(int listings)
+{
+    d->pool.setMaxThreadCount(std::max(listings, 1));
+}
+
+QStringList DirCrawler::crawl()
+{
+    d->mutex.lock();
+    d->files.clear();
+    d->folders = 0;
+    d->foldersExcluded = 0;
+    d->pending = 1;
+    d->stopped = false;
+    if (d->excluded.covers(d->root)) {
+        d->foldersExcluded = 1;
+        d->pending = 0;
+        d->mutex.unlock();
+        return QStringList();
+    }
+    d->mutex.unlock();
+
+    d->pool.start([this]() {
+        scanFolder(d->root);
+    });
+
+    d->mutex.lock();
+    while (d->pending > 0) {
+        d->done.wait(&d->mutex);
+    }
+    const QStringList files = d->files;
+    d->files.clear();
+    d->mutex.unlock();
+
+    return files;
+}
+
+int DirCrawler::foldersScanned() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->folders;
+}
+
+int DirCrawler::foldersExcluded() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->foldersExcluded;
+}
+
+bool DirCrawler::wasStopped() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->stopped;
+}
+
+void DirCrawler::scanFolder(const QString &path)
+{
+    QStringList found;
+    QStringList others;
+    QStringList subFolders;
+    int excluded = 0;
+
+    d->mutex.lock();
+    const bool stopped = d->stopped;
+    d->mutex.unlock();
+
+    // wanting the other files too means listing everything and matching here
+    const bool withOthers = static_cast<bool>(d->otherHandler);
+    QDirIterator it(path, withOthers ? QStringList() : d->nameFilters, d->dirFilters);
+    while (!stopped && it.hasNext()) {
+        const QString entry = it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            // same as QDirIterator::Subdirectories, symlinked folders stay put
+            if (!d->recursive || info.isSymLink()) {
+                continue;
+            }
+            if (d->excluded.covers(entry)) {
+                excluded++;
+            } else {
+                subFolders.append(entry);
+            }
+        } else if (!withOthers || QDir::match(d->nameFilters, info.fileName())) {
+            found.append(entry);
+        } else {
+            others.append(entry);
+        }
+    }
+
+    // outside the lock, the handlers may take their time
+    bool keepGoing = stopped || !d->handler || found.isEmpty() || d->handler(found);
+    if (keepGoing && !stopped && !others.isEmpty()) {
+        keepGoing = d->otherHandler(others);
+    }
+
+    d->mutex.lock();
+    if (!keepGoing) {
+        d->stopped = true;
+    }
+    if (d->stopped) {
+        subFolders.clear();
+    }
+    if (!d->handler) {
+        d->files.append(found);
+    }
+    d->folders++;
+    d->foldersExcluded += excluded;
+    // count the children before this one goes away, or the crawl could look finished
+    d->pending += subFolders.size() - 1;
+    if (d->pending == 0) {
+        d->done.wakeAll();
+    }
+    d->mutex.unlock();
+
+    for (const QString &sub : qAsConst(subFolders)) {
+        d->pool.start([this, sub]() {
+            scanFolder(sub);
+        });
+    }
+}
@@ -0,0 +1,99 @@
+#include "encoderworker.h"
+#include "libjxldecoder.h"
+#include "libjxlencoder.h"
+#include "memoryestimator.h"
+#include "workerprotocol.h"
+
+#ifdef HAVE_LIBJXL
+#include "sharedparallelrunner.h"
+#endif
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+
+const char *EncoderWorker::argument()
+{
+    return "--encode-worker";
+}
+
+int EncoderWorker::exec()
+{
+    QFile in;
+    QFile out;
+    if (!in.open(stdin, QIODevice::ReadOnly) || !out.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+
+    LibJxlEncoder encoder;
+    LibJxlDecoder decoder;
+    QMap<QString, QString> lastOptions;
+    QString optionError;
+    bool lastDecode = false;
+    bool haveOptions = false;
+
+    for (;;) {
+        // empty means the parent closed the pipe, time to go
+        const QByteArray line = in.readLine();
+        if (line.isEmpty()) {
+            break;
+        }
+
+        WorkerJob job;
+        WorkerReply reply;
+        if (!WorkerJob::fromLine(line.trimmed(), job)) {
+            reply.log = QString("Worker received a malformed job");
+            out.write(reply.toLine());
+            out.flush();
+            continue;
+        }
+        reply.id = job.id;
+
+        // the whole batch shares one option map, only parse it when it changes
+        if (!haveOptions || job.decode != lastDecode || job.options != lastOptions) {
+            optionError.clear();
+            if (job.decode) {
+                decoder.setOptions(job.options, &optionError);
+            } else {
+                encoder.setOptions(job.options, &optionError);
+            }
+            lastOptions = job.options;
+            lastDecode = job.decode;
+            haveOptions = true;
+        }
+
+        if (!optionError.isEmpty()) {
+            reply.needsBinary = true;
+            reply.log = optionError;
+        } else {
+#ifdef HAVE_LIBJXL
+            const int cores = (job.threads > 0) ? job.threads : QThread::idealThreadCount();
+            SharedParallelRunner::instance()->setWorkerCount(std::max(cores - 1, 0));
+#endif
+            MemoryEstimator::resetOwnPeakRss();
+
+            QElapsedTimer timer;
+            timer.start();
+            const LibJxlResult result = job.decode ? decoder.decode(job.input, job.output)
+                                                   : encoder.encode(job.input, job.output);
+
+            reply.exitCode = result.success ? 0 : 1;
+            reply.needsBinary = result.needsBinary;
+            reply.log = result.log;
+            reply.pixels = result.pixels;
+            reply.outputBytes = result.outputBytes;
+            reply.mps = result.mps;
+            reply.wallMs = timer.elapsed();
+            reply.peakRss = MemoryEstimator::readPeakRss(QCoreApplication::applicationPid());
+        }
+
+        out.write(reply.toLine());
+        out.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef ENCODERWORKER_H
+#define ENCODERWORKER_H
+
+/*
+ * Body of a long-lived worker process (the app started with
+ * EncoderWorker::argument()). libjxl is loaded once, then jobs come in
+ * as WorkerJob lines on stdin and go out as WorkerReply lines on stdout,
+ * one at a time, until the parent closes the pipe.
+ *
+ * A crash or a kill only takes down the job in flight, the parent just
+ * starts a fresh worker for the next one.
+ */
+class EncoderWorker
+{
+public:
+    static const char *argument();
+    static int exec();
+};
+
+#endif // ENCODERWORKER_H
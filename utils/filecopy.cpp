@@ -0,0 +1,170 @@
+#include "filecopy.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifdef Q_OS_MACOS
+#include <sys/clonefile.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+namespace
+{
+FileCopy::Result bufferedCopy(const QString &source, const QString &target)
+{
+    FileCopy::Result result;
+    if (QFile::copy(source, target)) {
+        result.success = true;
+        result.strategy = FileCopy::Strategy::Buffered;
+        result.bytes = QFileInfo(target).size();
+    }
+    return result;
+}
+
+#ifdef Q_OS_LINUX
+// kernel-side copy, false with nothing written if the filesystems can't do it
+bool copyRange(int in, int out, qint64 size, bool *unsupported)
+{
+    qint64 left = size;
+    while (left > 0) {
+        const ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(left), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // cross-device before 5.3, some network and fuse filesystems always
+            *unsupported = (left == size)
+                && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL || errno == EPERM);
+            return false;
+        }
+        if (n == 0) {
+            // shrunk under us
+            break;
+        }
+        left -= n;
+    }
+    return true;
+}
+#endif
+} // namespace
+
+FileCopy::Result FileCopy::copy(const QString &source, const QString &target)
+{
+#ifdef Q_OS_MACOS
+    // clonefile only works on the same APFS volume, and never replaces the target either
+    if (::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(target).constData(), 0) == 0) {
+        Result result;
+        result.success = true;
+        result.strategy = Strategy::Reflink;
+        result.bytes = QFileInfo(target).size();
+        return result;
+    }
+    if (errno == EEXIST) {
+        return Result();
+    }
+#endif
+
+#ifdef Q_OS_LINUX
+    const QByteArray src = QFile::encodeName(source);
+    const QByteArray dst = QFile::encodeName(target);
+
+    const int in = ::open(src.constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return Result();
+    }
+    struct stat st;
+    if (::fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(in);
+        return bufferedCopy(source, target);
+    }
+    const int out = ::open(dst.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777);
+    if (out < 0) {
+        ::close(in);
+        return Result();
+    }
+
+    Result result;
+    if (::ioctl(out, FICLONE, in) == 0) {
+        result.strategy = Strategy::Reflink;
+    } else {
+        bool unsupported = false;
+        if (copyRange(in, out, st.st_size, &unsupported)) {
+            result.strategy = Strategy::CopyFileRange;
+        } else if (!unsupported) {
+            // a real error halfway through, not just a filesystem that can't
+            ::close(in);
+            ::close(out);
+            ::unlink(dst.constData());
+            return Result();
+        }
+    }
+    ::close(in);
+    if (::close(out) != 0) {
+        ::unlink(dst.constData());
+        return Result();
+    }
+
+    if (result.strategy == Strategy::None) {
+        // QFile::copy won't write over the empty file we just made
+        ::unlink(dst.constData());
+        return bufferedCopy(source, target);
+    }
+    result.success = true;
+    result.bytes = st.st_size;
+    return result;
+#else
+    return bufferedCopy(source, target);
+#endif
+}
+
+FileCopy::Result FileCopy::linkOrCopy(const QString &source, const QString &target)
+{
+    // a hardlink costs no space, a copy is for when the filesystem won't have it
+    Result result;
+#ifdef Q_OS_UNIX
+    result.success = (::link(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0);
+#endif
+#ifdef Q_OS_WIN
+    result.success = CreateHardLinkW(reinterpret_cast<const wchar_t *>(target.utf16()),
+                                     reinterpret_cast<const wchar_t *>(source.utf16()),
+                                     nullptr)
+        != 0;
+#endif
+    if (result.success) {
+        result.strategy = Strategy::Hardlink;
+        return result;
+    }
+    return copy(source, target);
+}
+
+QString FileCopy::strategyName(Strategy strategy)
+{
+    switch (strategy) {
+    case Strategy::Hardlink:
+        return QString("hardlink");
+    case Strategy::Reflink:
+        return QString("reflink");
+    case Strategy::CopyFileRange:
+        return QString("copy_file_range");
+    case Strategy::Buffered:
+        return QString("buffered copy");
+    case Strategy::None:
+        break;
+    }
+    return QString("failed");
+}
@@ -0,0 +1,38 @@
+#ifndef FILECOPY_H
+#define FILECOPY_H
+
+#include <QString>
+
+/*
+ * File copies that let the filesystem do the work where it can: a reflink
+ * (FICLONE on Linux, clonefile on macOS) shares the extents and costs no
+ * data at all, copy_file_range keeps the bytes in the kernel, and only
+ * when neither works do they go through a buffer in user space.
+ *
+ * Like QFile::copy, an existing target is never overwritten.
+ */
+class FileCopy
+{
+public:
+    enum class Strategy {
+        None,
+        Hardlink,
+        Reflink,
+        CopyFileRange,
+        Buffered,
+    };
+
+    struct Result {
+        bool success = false;
+        Strategy strategy = Strategy::None;
+        qint64 bytes = 0;
+    };
+
+    static Result copy(const QString &source, const QString &target);
+    // a hardlink if the filesystem has them, a copy otherwise
+    static Result linkOrCopy(const QString &source, const QString &target);
+
+    static QString strategyName(Strategy strategy);
+};
+
+#endif // FILECOPY_H
@@ -0,0 +1,101 @@
+#include "filemirror.h"
+#include "filecopy.h"
+#include "logstats.h"
+#include "outputdircache.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+
+struct Q_DECL_HIDDEN FileMirror::Private
+{
+    QSharedPointer<OutputDirCache> outDirs;
+    bool overwrite = false;
+    bool hardlinks = false;
+
+    QThreadPool pool;
+    QAtomicInt stopped{0};
+};
+
+FileMirror::FileMirror(const QSharedPointer<OutputDirCache> &outDirs, bool overwrite, bool hardlinks)
+    : d(new Private)
+{
+    d->outDirs = outDirs;
+    d->overwrite = overwrite;
+    d->hardlinks = hardlinks;
+    // mostly waiting on the disk, reflinks and hardlinks barely touch the data
+    d->pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+}
+
+FileMirror::~FileMirror()
+{
+    stop();
+    d->pool.waitForDone();
+}
+
+void FileMirror::mirror(const QStringList &files)
+{
+    if (d->stopped.loadRelaxed()) {
+        return;
+    }
+    d->pool.start([this, files]() {
+        for (const QString &file : files) {
+            if (d->stopped.loadRelaxed()) {
+                return;
+            }
+            mirrorFile(file);
+        }
+    });
+}
+
+void FileMirror::stop()
+{
+    d->stopped.storeRelaxed(1);
+}
+
+bool FileMirror::waitForDone(int msecs)
+{
+    return d->pool.waitForDone(msecs);
+}
+
+void FileMirror::mirrorFile(const QString &file)
+{
+    LogStats *ls = LogStats::instance();
+
+    const QFileInfo source(file);
+    const QString outputDir = d->outDirs->outputDirFor(source.absolutePath());
+    if (!d->outDirs->ensure(outputDir)) {
+        ls->addMirrorFailed(file);
+        return;
+    }
+
+    const QString target = QDir::cleanPath(outputDir + QDir::separator() + source.fileName());
+    if (d->overwrite) {
+        if (QFile::exists(target)) {
+            QFile::remove(target);
+        }
+    } else if (!d->outDirs->claimMirror(outputDir, source.fileName())) {
+        ls->addMirrorSkipped();
+        return;
+    }
+
+    const FileCopy::Result result = d->hardlinks ? FileCopy::linkOrCopy(file, target) : FileCopy::copy(file, target);
+    if (!result.success) {
+        ls->addMirrorFailed(file);
+        return;
+    }
+
+    // a hardlink already shares it
+    if (result.strategy != FileCopy::Strategy::Hardlink) {
+        QFile out(target);
+        if (out.open(QIODevice::ReadWrite)) {
+            out.setFileTime(source.lastModified(), QFileDevice::FileModificationTime);
+        }
+    }
+
+    ls->addCopy(FileCopy::strategyName(result.strategy), result.bytes);
+    ls->addMirrored(source.size());
+}
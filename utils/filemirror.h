@@ -0,0 +1,42 @@
+#ifndef FILEMIRROR_H
+#define FILEMIRROR_H
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QStringList>
+
+class OutputDirCache;
+
+/*
+ * Puts the files a batch doesn't convert (sidecars, videos, XMP...) at
+ * their mirrored place in the output tree, fed straight from the folder
+ * scan so there's no second walk over the input.
+ *
+ * Each batch of files is copied on a small pool of its own, with a
+ * reflink or copy_file_range where the filesystem can (or a hardlink if
+ * asked for), and the copy keeps the source's modification time. With
+ * skip-existing on, a file already in the output is left alone.
+ *
+ * Results go to LogStats, separate from the converted files.
+ */
+class FileMirror
+{
+public:
+    FileMirror(const QSharedPointer<OutputDirCache> &outDirs, bool overwrite, bool hardlinks);
+    ~FileMirror();
+
+    FileMirror(const FileMirror &v) = delete;
+
+    // thread-safe, returns right away
+    void mirror(const QStringList &files);
+    void stop();
+    bool waitForDone(int msecs = -1);
+
+private:
+    void mirrorFile(const QString &file);
+
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // FILEMIRROR_H
@@ -0,0 +1,47 @@
+#include "imageinfo.h"
+
+#include <QImageReader>
+
+ImageInfo ImageInfo::probe(const QFileInfo &file)
+{
+    ImageInfo info;
+
+    // only reads the header, no pixel data is decoded here
+    QImageReader reader(file.absoluteFilePath());
+    const QSize size = reader.size();
+    if (size.isValid()) {
+        info.pixels = static_cast<qint64>(size.width()) * static_cast<qint64>(size.height());
+        info.isEstimated = false;
+
+        switch (reader.imageFormat()) {
+        case QImage::Format_RGBA64:
+        case QImage::Format_RGBA64_Premultiplied:
+        case QImage::Format_RGBX64:
+        case QImage::Format_Grayscale16:
+            info.bitDepth = 16;
+            break;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+        case QImage::Format_RGBA16FPx4:
+        case QImage::Format_RGBA16FPx4_Premultiplied:
+        case QImage::Format_RGBX16FPx4:
+            info.bitDepth = 16;
+            break;
+        case QImage::Format_RGBA32FPx4:
+        case QImage::Format_RGBA32FPx4_Premultiplied:
+        case QImage::Format_RGBX32FPx4:
+            info.bitDepth = 32;
+            break;
+#endif
+        default:
+            break;
+        }
+        return info;
+    }
+
+    // no plugin for this format (jxl, pfm, pgx...), guess from the file size instead
+    info.pixels = file.size() * 2;
+    if (file.suffix().compare("pfm", Qt::CaseInsensitive) == 0) {
+        info.bitDepth = 32;
+    }
+    return info;
+}
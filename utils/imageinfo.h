@@ -0,0 +1,19 @@
+#ifndef IMAGEINFO_H
+#define IMAGEINFO_H
+
+#include <QFileInfo>
+
+/*
+ * Cheap header-only look at an input image, used to size up a job
+ * before it gets started.
+ */
+struct ImageInfo
+{
+    qint64 pixels{0};
+    int bitDepth{8};
+    bool isEstimated{true};
+
+    static ImageInfo probe(const QFileInfo &file);
+};
+
+#endif // IMAGEINFO_H
@@ -0,0 +1,130 @@
+#include "jobqueue.h"
+#include "jobtable.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+
+struct Q_DECL_HIDDEN JobQueue::Private
+{
+    mutable QMutex mutex;
+    mutable QWaitCondition grown;
+    const QSharedPointer<JobTable> table{new JobTable()};
+    int count = 0;
+    std::function<void()> notifier;
+    int cursor = 0;
+    bool closed = false;
+};
+
+JobQueue::JobQueue()
+    : d(new Private)
+{
+}
+
+JobQueue::JobQueue(const QStringList &files)
+    : d(new Private)
+{
+    d->table->append(files);
+    d->count = files.size();
+    d->closed = true;
+}
+
+JobQueue::~JobQueue()
+{
+}
+
+bool JobQueue::append(const QStringList &files)
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->closed) {
+        return false;
+    }
+    if (!files.isEmpty()) {
+        d->table->append(files);
+        d->count += files.size();
+        d->grown.wakeAll();
+        if (d->notifier) {
+            d->notifier();
+        }
+    }
+    return true;
+}
+
+void JobQueue::close()
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->closed) {
+        return;
+    }
+    d->closed = true;
+    d->grown.wakeAll();
+    if (d->notifier) {
+        d->notifier();
+    }
+}
+
+bool JobQueue::isClosed() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->closed;
+}
+
+bool JobQueue::waitForFiles() const
+{
+    QMutexLocker locker(&d->mutex);
+    while (d->count == 0 && !d->closed) {
+        d->grown.wait(&d->mutex);
+    }
+    return d->count > 0;
+}
+
+void JobQueue::setNotifier(const std::function<void()> &notifier)
+{
+    // under the lock, so once this returns the old one is never called again
+    QMutexLocker locker(&d->mutex);
+    d->notifier = notifier;
+}
+
+QSharedPointer<JobTable> JobQueue::table() const
+{
+    return d->table;
+}
+
+bool JobQueue::takeNext(QString &file, int &index)
+{
+    d->mutex.lock();
+    if (d->cursor >= d->count) {
+        d->mutex.unlock();
+        return false;
+    }
+    index = d->cursor++;
+    d->mutex.unlock();
+
+    file = d->table->path(index);
+    return true;
+}
+
+QString JobQueue::first() const
+{
+    if (isEmpty()) {
+        return QString();
+    }
+    return d->table->path(0);
+}
+
+int JobQueue::size() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->count;
+}
+
+bool JobQueue::isEmpty() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->count == 0;
+}
+
+bool JobQueue::isDrained() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->closed && d->cursor >= d->count;
+}
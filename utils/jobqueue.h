@@ -0,0 +1,54 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include <functional>
+
+class JobTable;
+
+/*
+ * Shared list of input files for one conversion batch.
+ *
+ * Every worker pulls its next file from the same cursor, so a thread
+ * that lands on a run of huge images doesn't hold back the rest of the batch.
+ *
+ * A queue made without files stays open: the folder scan keeps appending
+ * while the first files are already converting, and close() marks the end.
+ *
+ * The files themselves live in a JobTable, a job's index in the queue is
+ * its index there.
+ */
+class JobQueue
+{
+public:
+    JobQueue();
+    explicit JobQueue(const QStringList &files);
+    ~JobQueue();
+
+    JobQueue(const JobQueue &v) = delete;
+
+    bool append(const QStringList &files);
+    void close();
+    bool isClosed() const;
+    bool waitForFiles() const;
+
+    // called from whichever thread appends or closes, keep it short
+    void setNotifier(const std::function<void()> &notifier);
+
+    QSharedPointer<JobTable> table() const;
+
+    bool takeNext(QString &file, int &index);
+    QString first() const;
+    int size() const;
+    bool isEmpty() const;
+    bool isDrained() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // JOBQUEUE_H
@@ -0,0 +1,160 @@
+#include "jobtable.h"
+#include "outputdircache.h"
+
+#include <QDir>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+// 16 bytes a job, the name itself lives in the arena
+struct Job {
+    quint32 dir = 0;
+    quint32 nameOffset = 0;
+    quint64 nameLength : 16;
+    quint64 status : 8; // bit index of the LogCode + 1, 0 while pending
+    quint64 inputSize : 40;
+};
+
+constexpr quint64 MaxInputSize = (quint64(1) << 40) - 1;
+
+struct Dir {
+    // with the trailing slash, a path is just this and the name
+    QString prefix;
+    QString path;
+    QString output;
+    bool hasOutput = false;
+};
+} // namespace
+
+struct Q_DECL_HIDDEN JobTable::Private
+{
+    mutable QReadWriteLock lock;
+    QVector<Job> jobs;
+    QVector<Dir> dirs;
+    QHash<QString, int> dirIndex;
+    QByteArray names;
+};
+
+JobTable::JobTable()
+    : d(new Private)
+{
+}
+
+JobTable::~JobTable()
+{
+}
+
+void JobTable::append(const QStringList &paths)
+{
+    QWriteLocker locker(&d->lock);
+    d->jobs.reserve(d->jobs.size() + paths.size());
+
+    // a batch from the scan is one folder, so the lookup mostly hits the previous one
+    int lastDir = -1;
+    for (const QString &nativePath : paths) {
+        const QString path = QDir::fromNativeSeparators(nativePath);
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        const QString prefix = path.left(slash + 1);
+        if (lastDir < 0 || d->dirs.at(lastDir).prefix != prefix) {
+            const auto it = d->dirIndex.constFind(prefix);
+            if (it != d->dirIndex.constEnd()) {
+                lastDir = it.value();
+            } else {
+                lastDir = d->dirs.size();
+                Dir dir;
+                dir.prefix = prefix;
+                dir.path = prefix.isEmpty() ? QString() : QDir::cleanPath(prefix);
+                d->dirs.append(dir);
+                d->dirIndex.insert(prefix, lastDir);
+            }
+        }
+
+        const QByteArray name = path.mid(slash + 1).toUtf8();
+        Job job;
+        job.dir = static_cast<quint32>(lastDir);
+        // offsets are 32 bits, 4 GiB of names is far beyond any batch
+        job.nameOffset = static_cast<quint32>(d->names.size());
+        job.nameLength = static_cast<quint64>(std::min<int>(name.size(), std::numeric_limits<quint16>::max()));
+        job.status = 0;
+        job.inputSize = 0;
+        d->names.append(name.constData(), job.nameLength);
+        d->jobs.append(job);
+    }
+}
+
+int JobTable::size() const
+{
+    QReadLocker locker(&d->lock);
+    return d->jobs.size();
+}
+
+QString JobTable::path(int job) const
+{
+    QReadLocker locker(&d->lock);
+    const Job &j = d->jobs.at(job);
+    return d->dirs.at(j.dir).prefix + QString::fromUtf8(d->names.constData() + j.nameOffset, j.nameLength);
+}
+
+QString JobTable::fileName(int job) const
+{
+    QReadLocker locker(&d->lock);
+    const Job &j = d->jobs.at(job);
+    return QString::fromUtf8(d->names.constData() + j.nameOffset, j.nameLength);
+}
+
+QString JobTable::dir(int job) const
+{
+    QReadLocker locker(&d->lock);
+    return d->dirs.at(d->jobs.at(job).dir).path;
+}
+
+QString JobTable::outputDirFor(int job, const OutputDirCache &outDirs)
+{
+    d->lock.lockForRead();
+    const int dirIndex = d->jobs.at(job).dir;
+    const Dir dir = d->dirs.at(dirIndex);
+    d->lock.unlock();
+
+    if (dir.hasOutput) {
+        return dir.output;
+    }
+
+    // once per folder, every other job in it gets it from here
+    const QString output = outDirs.outputDirFor(dir.path);
+    QWriteLocker locker(&d->lock);
+    Dir &stored = d->dirs[dirIndex];
+    stored.output = output;
+    stored.hasOutput = true;
+    return output;
+}
+
+LogCode JobTable::status(int job) const
+{
+    QReadLocker locker(&d->lock);
+    const quint64 status = d->jobs.at(job).status;
+    return static_cast<LogCode>(status ? (1 << (status - 1)) : 0);
+}
+
+void JobTable::setStatus(int job, LogCode code)
+{
+    QWriteLocker locker(&d->lock);
+    d->jobs[job].status = qCountTrailingZeroBits(static_cast<quint32>(code)) + 1;
+}
+
+qint64 JobTable::inputSize(int job) const
+{
+    QReadLocker locker(&d->lock);
+    return static_cast<qint64>(d->jobs.at(job).inputSize);
+}
+
+void JobTable::setInputSize(int job, qint64 size)
+{
+    QWriteLocker locker(&d->lock);
+    d->jobs[job].inputSize = std::min(static_cast<quint64>(std::max<qint64>(size, 0)), MaxInputSize);
+}
@@ -0,0 +1,49 @@
+#ifndef JOBTABLE_H
+#define JOBTABLE_H
+
+#include "logcodes.h"
+
+#include <QScopedPointer>
+#include <QStringList>
+
+class OutputDirCache;
+
+/*
+ * Every input of one batch, stored compactly enough for batches of
+ * millions of files. Everything else refers to a job by its index.
+ *
+ * Folders are interned once, with their output folder worked out the
+ * first time a job in them asks. Basenames are packed as UTF-8 into one
+ * buffer, and status and input size share one word per job. A full path
+ * is only put together when someone asks for it.
+ *
+ * Thread-safe, the scan appends while workers read.
+ */
+class JobTable
+{
+public:
+    JobTable();
+    ~JobTable();
+
+    JobTable(const JobTable &v) = delete;
+
+    void append(const QStringList &paths);
+    int size() const;
+
+    QString path(int job) const;
+    QString fileName(int job) const;
+    QString dir(int job) const;
+    QString outputDirFor(int job, const OutputDirCache &outDirs);
+
+    // 0 while the job hasn't finished
+    LogCode status(int job) const;
+    void setStatus(int job, LogCode code);
+    qint64 inputSize(int job) const;
+    void setInputSize(int job, qint64 size);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // JOBTABLE_H
@@ -0,0 +1,302 @@
+#include "libjxldecoder.h"
+
+#ifdef HAVE_LIBJXL
+#include "sharedparallelrunner.h"
+#endif
+
+#include <QColorSpace>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QMapIterator>
+#include <QSaveFile>
+#include <QtEndian>
+
+#ifdef HAVE_LIBJXL
+#include <jxl/decode.h>
+#include <jxl/decode_cxx.h>
+#include <jxl/version.h>
+
+#include <vector>
+#endif
+
+bool LibJxlDecoder::isAvailable()
+{
+#ifdef HAVE_LIBJXL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LibJxlDecoder::setOptions(const QMap<QString, QString> &opts, QString *reason)
+{
+    m_format.clear();
+
+#ifndef HAVE_LIBJXL
+    Q_UNUSED(opts);
+    if (reason) {
+        *reason = QString("built without libjxl");
+    }
+    return false;
+#else
+    QMapIterator<QString, QString> mit(opts);
+    while (mit.hasNext()) {
+        mit.next();
+
+        const QString &key = mit.key();
+        const QString &value = mit.value();
+
+        if (key == "customFlags" && !value.trimmed().isEmpty()) {
+            if (reason) {
+                *reason = QString("custom flags need djxl");
+            }
+            return false;
+        }
+
+        if (key == "outFormat") {
+            m_format = value.toLower();
+        } else if (key.contains("-")) {
+            if (reason) {
+                *reason = QString("%1 has no in-process counterpart").arg(key);
+            }
+            return false;
+        }
+    }
+
+    if (m_format != ".png" && m_format != ".ppm" && m_format != ".pfm") {
+        if (reason) {
+            *reason = QString("%1 output needs djxl").arg(m_format);
+        }
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+LibJxlResult LibJxlDecoder::decode(const QString &fin, const QString &fout, const QAtomicInt *cancel) const
+{
+    LibJxlResult result;
+
+#ifndef HAVE_LIBJXL
+    Q_UNUSED(fin);
+    Q_UNUSED(fout);
+    Q_UNUSED(cancel);
+    result.log = QString("Built without libjxl");
+    return result;
+#else
+    // like djxl's MP/s, reading the input and writing the output don't count
+    QElapsedTimer timer;
+
+    const auto fail = [&result](const QString &msg) {
+        result.success = false;
+        result.log = msg;
+        return result;
+    };
+
+    QFile inFile(fin);
+    if (!inFile.open(QIODevice::ReadOnly)) {
+        return fail(QString("Failed to read input: %1").arg(inFile.errorString()));
+    }
+    const QByteArray data = inFile.readAll();
+    inFile.close();
+    timer.start();
+
+    const JxlDecoderPtr dec = JxlDecoderMake(nullptr);
+    if (!dec) {
+        return fail(QString("Failed to create decoder"));
+    }
+    // every in-flight job shares the same worker threads
+    SharedParallelRunner *runner = SharedParallelRunner::instance();
+    if (JxlDecoderSetParallelRunner(dec.get(), SharedParallelRunner::run, runner) != JXL_DEC_SUCCESS
+        || JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_COLOR_ENCODING | JXL_DEC_FULL_IMAGE)
+            != JXL_DEC_SUCCESS) {
+        return fail(QString("Failed to set up decoder"));
+    }
+
+    JxlDecoderSetInput(dec.get(), reinterpret_cast<const uint8_t *>(data.constData()), data.size());
+    JxlDecoderCloseInput(dec.get());
+
+    const bool isPng = (m_format == ".png");
+    const bool isPfm = (m_format == ".pfm");
+
+    JxlBasicInfo info;
+    JxlPixelFormat format = {3, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0};
+    // PPM keeps the source's own range, a 12-bit image gets maxval 4095, not a stretch to 65535
+    int ppmBits = 8;
+    bool isGray = false;
+    QByteArray icc;
+    // PNG goes straight into a QImage, PPM/PFM into a tightly packed buffer
+    QImage image;
+    std::vector<uint8_t> pixels;
+
+    for (;;) {
+        // every event is a chance to give up, the full image is the last of them
+        if (cancel && cancel->loadRelaxed()) {
+            return fail(QString("Cancelled"));
+        }
+        const JxlDecoderStatus status = JxlDecoderProcessInput(dec.get());
+
+        if (status == JXL_DEC_ERROR) {
+            return fail(QString("Decoding failed"));
+        } else if (status == JXL_DEC_NEED_MORE_INPUT) {
+            return fail(QString("Decoding failed: truncated input"));
+        } else if (status == JXL_DEC_BASIC_INFO) {
+            if (JxlDecoderGetBasicInfo(dec.get(), &info) != JXL_DEC_SUCCESS) {
+                return fail(QString("Failed to read basic info"));
+            }
+            if (info.have_animation) {
+                result.needsBinary = true;
+                result.log = QString("Animation needs djxl");
+                return result;
+            }
+
+            isGray = (info.num_color_channels == 1);
+            const bool hasAlpha = (info.alpha_bits > 0);
+            const bool highDepth = (info.bits_per_sample > 8);
+
+            if (isPfm) {
+                // PFM has no alpha and is little endian here, see the negative scale below
+                format = {isGray ? 1u : 3u, JXL_TYPE_FLOAT, JXL_LITTLE_ENDIAN, 0};
+            } else if (!isPng) {
+                // binary PPM/PGM samples are big endian, alpha is dropped
+                format = {isGray ? 1u : 3u, highDepth ? JXL_TYPE_UINT16 : JXL_TYPE_UINT8, JXL_BIG_ENDIAN, 0};
+                ppmBits = highDepth ? qMin<int>(info.bits_per_sample, 16) : 8;
+            } else {
+                // match a QImage format, gray with alpha has none so it becomes RGBA
+                QImage::Format qfmt = QImage::Format_RGB888;
+                uint32_t channels = 3;
+                if (isGray && !hasAlpha) {
+                    qfmt = highDepth ? QImage::Format_Grayscale16 : QImage::Format_Grayscale8;
+                    channels = 1;
+                } else if (highDepth) {
+                    qfmt = hasAlpha ? QImage::Format_RGBA64 : QImage::Format_RGBX64;
+                    channels = 4;
+                } else if (hasAlpha) {
+                    qfmt = QImage::Format_RGBA8888;
+                    channels = 4;
+                }
+                // QImage rows are 4-byte aligned
+                format = {channels, highDepth ? JXL_TYPE_UINT16 : JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 4};
+                image = QImage(info.xsize, info.ysize, qfmt);
+                if (image.isNull()) {
+                    return fail(QString("Failed to allocate %1 x %2 image").arg(QString::number(info.xsize), QString::number(info.ysize)));
+                }
+            }
+            result.pixels = static_cast<qint64>(info.xsize) * info.ysize;
+        } else if (status == JXL_DEC_COLOR_ENCODING) {
+            if (isPng) {
+                size_t iccSize = 0;
+#if JPEGXL_NUMERIC_VERSION >= JPEGXL_COMPUTE_NUMERIC_VERSION(0, 9, 0)
+                if (JxlDecoderGetICCProfileSize(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA, &iccSize) == JXL_DEC_SUCCESS
+                    && iccSize > 0) {
+                    icc.resize(iccSize);
+                    JxlDecoderGetColorAsICCProfile(dec.get(), JXL_COLOR_PROFILE_TARGET_DATA, reinterpret_cast<uint8_t *>(icc.data()), iccSize);
+                }
+#else
+                if (JxlDecoderGetICCProfileSize(dec.get(), &format, JXL_COLOR_PROFILE_TARGET_DATA, &iccSize) == JXL_DEC_SUCCESS
+                    && iccSize > 0) {
+                    icc.resize(iccSize);
+                    JxlDecoderGetColorAsICCProfile(dec.get(), &format, JXL_COLOR_PROFILE_TARGET_DATA, reinterpret_cast<uint8_t *>(icc.data()), iccSize);
+                }
+#endif
+            }
+        } else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
+            size_t bufferSize = 0;
+            if (JxlDecoderImageOutBufferSize(dec.get(), &format, &bufferSize) != JXL_DEC_SUCCESS) {
+                return fail(QString("Failed to get output buffer size"));
+            }
+            void *buffer = nullptr;
+            if (isPng) {
+                if (bufferSize > static_cast<size_t>(image.sizeInBytes())) {
+                    return fail(QString("Output buffer size mismatch"));
+                }
+                buffer = image.bits();
+                bufferSize = image.sizeInBytes();
+            } else {
+                pixels.resize(bufferSize);
+                buffer = pixels.data();
+            }
+            if (JxlDecoderSetImageOutBuffer(dec.get(), &format, buffer, bufferSize) != JXL_DEC_SUCCESS) {
+                return fail(QString("Failed to set output buffer"));
+            }
+#if JPEGXL_NUMERIC_VERSION >= JPEGXL_COMPUTE_NUMERIC_VERSION(0, 8, 0)
+            if (ppmBits > 8 && ppmBits < 16) {
+                const JxlBitDepth depth = {JXL_BIT_DEPTH_FROM_CODESTREAM, 0, 0};
+                if (JxlDecoderSetImageOutBitDepth(dec.get(), &depth) != JXL_DEC_SUCCESS) {
+                    return fail(QString("Failed to set output bit depth"));
+                }
+            }
+#endif
+        } else if (status == JXL_DEC_FULL_IMAGE) {
+            // still image, nothing more to wait for
+            break;
+        } else if (status == JXL_DEC_SUCCESS) {
+            break;
+        }
+    }
+
+    const double secs = timer.nsecsElapsed() / 1e9;
+
+#if JPEGXL_NUMERIC_VERSION < JPEGXL_COMPUTE_NUMERIC_VERSION(0, 8, 0)
+    // no output bit depth setting yet, the samples come stretched to 16 bits, undo that
+    if (ppmBits > 8 && ppmBits < 16) {
+        const quint32 maxVal = (1u << ppmBits) - 1;
+        uchar *sample = pixels.data();
+        for (size_t i = 0; i + 1 < pixels.size(); i += 2) {
+            const quint32 wide = qFromBigEndian<quint16>(sample + i);
+            qToBigEndian<quint16>(static_cast<quint16>((wide * maxVal + 32767) / 65535), sample + i);
+        }
+    }
+#endif
+
+    // nothing lands on the destination unless the whole file made it
+    QSaveFile outFile(fout);
+    if (!outFile.open(QIODevice::WriteOnly)) {
+        return fail(QString("Failed to write output: %1").arg(outFile.errorString()));
+    }
+
+    if (isPng) {
+        if (!icc.isEmpty()) {
+            image.setColorSpace(QColorSpace::fromIccProfile(icc));
+        }
+        QImageWriter writer(&outFile, "png");
+        if (!writer.write(image)) {
+            outFile.cancelWriting();
+            return fail(QString("Failed to write output: %1").arg(writer.errorString()));
+        }
+    } else {
+        const char magic = isPfm ? (isGray ? 'f' : 'F') : (isGray ? '5' : '6');
+        const QString maxVal = isPfm ? QString("-1.0") : QString::number((1 << ppmBits) - 1);
+        const QByteArray header = QString("P%1\n%2 %3\n%4\n")
+                                      .arg(QString(QChar(magic)), QString::number(info.xsize), QString::number(info.ysize), maxVal)
+                                      .toLatin1();
+        outFile.write(header);
+        if (isPfm) {
+            // PFM rows go bottom to top
+            const size_t rowBytes = pixels.size() / info.ysize;
+            for (qint64 y = info.ysize - 1; y >= 0; y--) {
+                outFile.write(reinterpret_cast<const char *>(pixels.data() + y * rowBytes), rowBytes);
+            }
+        } else {
+            outFile.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+        }
+    }
+
+    if (!outFile.commit()) {
+        return fail(QString("Failed to write output: %1").arg(outFile.errorString()));
+    }
+
+    result.success = true;
+    result.outputBytes = QFile(fout).size();
+    result.mps = (secs > 0.0) ? (result.pixels / 1e6) / secs : 0.0;
+    result.log = QString("Decoded to %1 bytes.\n%2 x %3, %4 MP/s [in-process, shared runner].")
+                     .arg(QString::number(result.outputBytes),
+                          QString::number(info.xsize),
+                          QString::number(info.ysize),
+                          QString::number(result.mps, 'f', 3));
+    return result;
+#endif
+}
@@ -0,0 +1,30 @@
+#ifndef LIBJXLDECODER_H
+#define LIBJXLDECODER_H
+
+#include "libjxlresult.h"
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QString>
+
+/*
+ * djxl counterpart of LibJxlEncoder: decodes a single still image to
+ * PNG, PPM or PFM without spawning a process. Animations and the other
+ * output formats are left to djxl.
+ *
+ * decode() is const and may be called from several threads at once.
+ */
+class LibJxlDecoder
+{
+public:
+    static bool isAvailable();
+
+    bool setOptions(const QMap<QString, QString> &opts, QString *reason = nullptr);
+    // cancel is polled between stages, a set flag ends the job early without an output
+    LibJxlResult decode(const QString &fin, const QString &fout, const QAtomicInt *cancel = nullptr) const;
+
+private:
+    QString m_format;
+};
+
+#endif // LIBJXLDECODER_H
@@ -0,0 +1,484 @@
+#include "libjxlencoder.h"
+
+#ifdef HAVE_LIBJXL
+#include "sharedparallelrunner.h"
+#endif
+
+#include <QColorSpace>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QMapIterator>
+#include <QSaveFile>
+#include <QtEndian>
+
+#ifdef HAVE_LIBJXL
+#include <jxl/encode.h>
+#include <jxl/encode_cxx.h>
+
+#include <vector>
+
+namespace
+{
+// same curve cjxl uses to turn -q into a distance
+float distanceFromQuality(float quality)
+{
+    if (quality >= 100.0f) {
+        return 0.0f;
+    } else if (quality >= 30.0f) {
+        return 0.1f + (100.0f - quality) * 0.09f;
+    }
+    return 53.0f / 3000.0f * quality * quality - 23.0f / 20.0f * quality + 25.0f;
+}
+
+QString encoderError(JxlEncoder *enc)
+{
+    switch (JxlEncoderGetError(enc)) {
+    case JXL_ENC_ERR_OOM:
+        return QString("out of memory");
+    case JXL_ENC_ERR_JBRD:
+        return QString("JPEG bitstream reconstruction data could not be represented");
+    case JXL_ENC_ERR_BAD_INPUT:
+        return QString("bad input");
+    case JXL_ENC_ERR_NOT_SUPPORTED:
+        return QString("not supported");
+    case JXL_ENC_ERR_API_USAGE:
+        return QString("API usage error");
+    default:
+        return QString("generic error");
+    }
+}
+
+// tightly packs the first channels of every pixel, dropping Qt's padding and X channel
+template<typename T>
+QByteArray packPixels(const QImage &image, int channels)
+{
+    const int srcChannels = image.depth() / (8 * static_cast<int>(sizeof(T)));
+    QByteArray buffer(static_cast<qsizetype>(image.width()) * image.height() * channels * sizeof(T), Qt::Uninitialized);
+    T *dst = reinterpret_cast<T *>(buffer.data());
+    for (int y = 0; y < image.height(); y++) {
+        const T *src = reinterpret_cast<const T *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            for (int c = 0; c < channels; c++) {
+                *dst++ = src[x * srcChannels + c];
+            }
+        }
+    }
+    return buffer;
+}
+
+// cjxl carries EXIF and XMP over into boxes of the JXL, the pixels Qt hands back come without them,
+// only the chunks/segments are looked at, never the image data
+bool hasExifOrXmp(const QString &path, const QByteArray &format)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    if (format == "png") {
+        if (file.read(8) != QByteArray("\x89PNG\r\n\x1a\n", 8)) {
+            return false;
+        }
+        for (;;) {
+            const QByteArray head = file.read(8);
+            if (head.size() < 8) {
+                return false;
+            }
+            const quint32 length = qFromBigEndian<quint32>(head.constData());
+            const QByteArray type = head.mid(4);
+            if (type == "eXIf") {
+                return true;
+            }
+            if (type == "iTXt" || type == "tEXt" || type == "zTXt") {
+                // keyword first, ImageMagick and exiftool stash raw profiles in text chunks too
+                const QByteArray keyword = file.peek(qMin<quint32>(length, 80));
+                if (keyword.startsWith("XML:com.adobe.xmp") || keyword.startsWith("Raw profile type exif")
+                    || keyword.startsWith("Raw profile type APP1") || keyword.startsWith("Raw profile type xmp")) {
+                    return true;
+                }
+            }
+            if (type == "IEND" || !file.seek(file.pos() + length + 4)) {
+                return false;
+            }
+        }
+    }
+
+    if (format == "jpeg" || format == "jpg") {
+        if (file.read(2) != QByteArray("\xff\xd8", 2)) {
+            return false;
+        }
+        for (;;) {
+            const QByteArray head = file.read(4);
+            if (head.size() < 4 || static_cast<uchar>(head.at(0)) != 0xff) {
+                return false;
+            }
+            const uchar marker = head.at(1);
+            // image data follows, no more metadata segments before it
+            if (marker == 0xda || marker == 0xd9) {
+                return false;
+            }
+            const quint16 length = qFromBigEndian<quint16>(head.constData() + 2);
+            if (marker == 0xe1) {
+                const QByteArray id = file.peek(29);
+                if (id.startsWith(QByteArray("Exif\0\0", 6)) || id.startsWith("http://ns.adobe.com/xap/1.0/")) {
+                    return true;
+                }
+            }
+            if (length < 2 || !file.seek(file.pos() + length - 2)) {
+                return false;
+            }
+        }
+    }
+
+    if (format == "gif") {
+        // XMP sits in an application extension, anywhere between the frames
+        return file.readAll().contains("XMP DataXMP");
+    }
+
+    // PPM, BMP and the like have nowhere to keep it, cjxl doesn't read the rest at all
+    return false;
+}
+} // namespace
+#endif
+
+bool LibJxlEncoder::isAvailable()
+{
+#ifdef HAVE_LIBJXL
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString LibJxlEncoder::version()
+{
+#ifdef HAVE_LIBJXL
+    const uint32_t ver = JxlEncoderVersion();
+    return QString("libjxl v%1.%2.%3")
+        .arg(QString::number(ver / 1000000), QString::number((ver / 1000) % 1000), QString::number(ver % 1000));
+#else
+    return QString();
+#endif
+}
+
+bool LibJxlEncoder::setOptions(const QMap<QString, QString> &opts, QString *reason)
+{
+    m_distance = 1.0f;
+    m_jpegTran = true;
+    m_intSettings.clear();
+    m_floatSettings.clear();
+
+#ifndef HAVE_LIBJXL
+    Q_UNUSED(opts);
+    if (reason) {
+        *reason = QString("built without libjxl");
+    }
+    return false;
+#else
+    QMapIterator<QString, QString> mit(opts);
+    while (mit.hasNext()) {
+        mit.next();
+
+        const QString &key = mit.key();
+        const QString &value = mit.value();
+
+        if (key == "customFlags" && !value.trimmed().isEmpty()) {
+            if (reason) {
+                *reason = QString("custom flags need cjxl");
+            }
+            return false;
+        }
+
+        // same rule as the cjxl path: keys without a dash never become flags
+        if (!key.contains("-")) {
+            continue;
+        }
+
+        bool ok = false;
+        const auto addInt = [&](JxlEncoderFrameSettingId id) {
+            m_intSettings.append({static_cast<int>(id), value.toLongLong(&ok)});
+        };
+
+        if (key == "-d") {
+            m_distance = value.toFloat(&ok);
+        } else if (key == "-q") {
+            m_distance = distanceFromQuality(value.toFloat(&ok));
+        } else if (key == "-j") {
+            m_jpegTran = (value == "1");
+            ok = true;
+        } else if (key == "-e") {
+            addInt(JXL_ENC_FRAME_SETTING_EFFORT);
+        } else if (key == "-m") {
+            addInt(JXL_ENC_FRAME_SETTING_MODULAR);
+        } else if (key == "--epf") {
+            addInt(JXL_ENC_FRAME_SETTING_EPF);
+        } else if (key == "--gaborish") {
+            addInt(JXL_ENC_FRAME_SETTING_GABORISH);
+        } else if (key == "--patches") {
+            addInt(JXL_ENC_FRAME_SETTING_PATCHES);
+        } else if (key == "--dots") {
+            addInt(JXL_ENC_FRAME_SETTING_DOTS);
+        } else if (key == "--faster_decoding") {
+            addInt(JXL_ENC_FRAME_SETTING_DECODING_SPEED);
+        } else if (key == "--photon_noise_iso" || key == "--photon_noise") {
+            // older cjxl takes it as "ISO3200"
+            const float iso = QString(value).remove("ISO", Qt::CaseInsensitive).toFloat(&ok);
+            m_floatSettings.append({static_cast<int>(JXL_ENC_FRAME_SETTING_PHOTON_NOISE), iso});
+        } else {
+            if (reason) {
+                *reason = QString("%1 has no in-process counterpart").arg(key);
+            }
+            return false;
+        }
+
+        if (!ok) {
+            if (reason) {
+                *reason = QString("invalid value for %1: %2").arg(key, value);
+            }
+            return false;
+        }
+    }
+
+    return true;
+#endif
+}
+
+LibJxlResult LibJxlEncoder::encode(const QString &fin, const QString &fout, const QAtomicInt *cancel) const
+{
+    LibJxlResult result;
+
+#ifndef HAVE_LIBJXL
+    Q_UNUSED(fin);
+    Q_UNUSED(fout);
+    Q_UNUSED(cancel);
+    result.log = QString("Built without libjxl");
+    return result;
+#else
+    // like cjxl's MP/s, only the encode is timed, reading and writing the files isn't
+    QElapsedTimer timer;
+
+    const auto fail = [&result](const QString &msg) {
+        result.success = false;
+        result.log = msg;
+        return result;
+    };
+    const auto cancelled = [cancel]() {
+        return cancel && cancel->loadRelaxed();
+    };
+
+    const JxlEncoderPtr enc = JxlEncoderMake(nullptr);
+    if (!enc) {
+        return fail(QString("Failed to create encoder"));
+    }
+    // every in-flight job shares the same worker threads
+    SharedParallelRunner *runner = SharedParallelRunner::instance();
+    if (JxlEncoderSetParallelRunner(enc.get(), SharedParallelRunner::run, runner) != JXL_ENC_SUCCESS) {
+        return fail(QString("Failed to set parallel runner"));
+    }
+
+    JxlEncoderFrameSettings *settings = JxlEncoderFrameSettingsCreate(enc.get(), nullptr);
+    for (const auto &st : m_intSettings) {
+        if (JxlEncoderFrameSettingsSetOption(settings, static_cast<JxlEncoderFrameSettingId>(st.first), st.second)
+            != JXL_ENC_SUCCESS) {
+            return fail(QString("Encoder rejected setting %1 = %2").arg(QString::number(st.first), QString::number(st.second)));
+        }
+    }
+    for (const auto &st : m_floatSettings) {
+        if (JxlEncoderFrameSettingsSetFloatOption(settings, static_cast<JxlEncoderFrameSettingId>(st.first), st.second)
+            != JXL_ENC_SUCCESS) {
+            return fail(QString("Encoder rejected setting %1 = %2").arg(QString::number(st.first), QString::number(st.second)));
+        }
+    }
+
+    const QFileInfo inFile(fin);
+    const bool isJpeg = inFile.suffix().contains("jpg", Qt::CaseInsensitive)
+        || inFile.suffix().contains("jpeg", Qt::CaseInsensitive) || inFile.suffix().contains("jfif", Qt::CaseInsensitive);
+
+    if (isJpeg && m_jpegTran) {
+        // lossless transcode, the JPEG bitstream goes in as is
+        QFile jpegFile(fin);
+        if (!jpegFile.open(QIODevice::ReadOnly)) {
+            return fail(QString("Failed to read input: %1").arg(jpegFile.errorString()));
+        }
+        const QByteArray jpeg = jpegFile.readAll();
+        jpegFile.close();
+        timer.start();
+
+        const QSize size = QImageReader(fin).size();
+        result.pixels = size.isValid() ? static_cast<qint64>(size.width()) * size.height() : 0;
+
+        if (JxlEncoderStoreJPEGMetadata(enc.get(), JXL_TRUE) != JXL_ENC_SUCCESS
+            || JxlEncoderAddJPEGFrame(settings, reinterpret_cast<const uint8_t *>(jpeg.constData()), jpeg.size())
+                != JXL_ENC_SUCCESS) {
+            return fail(QString("Failed to transcode JPEG: %1").arg(encoderError(enc.get())));
+        }
+    } else {
+        // animations and formats Qt can't read (EXR, PGX...) are cjxl's business
+        QImageReader reader(fin);
+        if (!reader.canRead() || reader.imageCount() > 1) {
+            result.needsBinary = true;
+            result.log = QString("Input needs cjxl");
+            return result;
+        }
+        // the output would silently differ from cjxl's otherwise
+        if (hasExifOrXmp(fin, reader.format())) {
+            result.needsBinary = true;
+            result.log = QString("Input has EXIF/XMP metadata, needs cjxl");
+            return result;
+        }
+        QImage image = reader.read();
+        if (image.isNull()) {
+            return fail(QString("Failed to decode input: %1").arg(reader.errorString()));
+        }
+        result.pixels = static_cast<qint64>(image.width()) * image.height();
+
+        const bool hasAlpha = image.hasAlphaChannel();
+        const bool isGray = !hasAlpha
+            && (image.format() == QImage::Format_Grayscale8 || image.format() == QImage::Format_Grayscale16);
+
+        int bits = 8;
+        JxlDataType dataType = JXL_TYPE_UINT8;
+        switch (image.format()) {
+        case QImage::Format_Grayscale16:
+        case QImage::Format_RGBA64:
+        case QImage::Format_RGBA64_Premultiplied:
+        case QImage::Format_RGBX64:
+            bits = 16;
+            dataType = JXL_TYPE_UINT16;
+            break;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+        case QImage::Format_RGBA16FPx4:
+        case QImage::Format_RGBA16FPx4_Premultiplied:
+        case QImage::Format_RGBX16FPx4:
+        case QImage::Format_RGBA32FPx4:
+        case QImage::Format_RGBA32FPx4_Premultiplied:
+        case QImage::Format_RGBX32FPx4:
+            bits = 32;
+            dataType = JXL_TYPE_FLOAT;
+            break;
+#endif
+        default:
+            break;
+        }
+
+        const int channels = (isGray ? 1 : 3) + (hasAlpha ? 1 : 0);
+        QByteArray pixels;
+        if (dataType == JXL_TYPE_UINT8) {
+            image.convertTo(isGray ? QImage::Format_Grayscale8 : QImage::Format_RGBA8888);
+            pixels = packPixels<uint8_t>(image, channels);
+        } else if (dataType == JXL_TYPE_UINT16) {
+            image.convertTo(isGray ? QImage::Format_Grayscale16 : QImage::Format_RGBA64);
+            pixels = packPixels<uint16_t>(image, channels);
+        } else {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+            image.convertTo(QImage::Format_RGBA32FPx4);
+            pixels = packPixels<float>(image, channels);
+#endif
+        }
+
+        timer.start();
+
+        const bool lossless = (m_distance <= 0.0f);
+
+        JxlBasicInfo info;
+        JxlEncoderInitBasicInfo(&info);
+        info.xsize = image.width();
+        info.ysize = image.height();
+        info.bits_per_sample = bits;
+        info.exponent_bits_per_sample = (dataType == JXL_TYPE_FLOAT) ? 8 : 0;
+        info.num_color_channels = isGray ? 1 : 3;
+        info.num_extra_channels = hasAlpha ? 1 : 0;
+        info.alpha_bits = hasAlpha ? bits : 0;
+        info.alpha_exponent_bits = hasAlpha ? info.exponent_bits_per_sample : 0;
+        info.uses_original_profile = lossless ? JXL_TRUE : JXL_FALSE;
+        if (JxlEncoderSetBasicInfo(enc.get(), &info) != JXL_ENC_SUCCESS) {
+            return fail(QString("Failed to set basic info: %1").arg(encoderError(enc.get())));
+        }
+
+        // embed the source profile when there is one, cjxl does the same
+        const QByteArray icc = image.colorSpace().iccProfile();
+        if (!icc.isEmpty() && image.colorSpace() != QColorSpace(QColorSpace::SRgb)) {
+            if (JxlEncoderSetICCProfile(enc.get(), reinterpret_cast<const uint8_t *>(icc.constData()), icc.size())
+                != JXL_ENC_SUCCESS) {
+                return fail(QString("Failed to set ICC profile: %1").arg(encoderError(enc.get())));
+            }
+        } else {
+            JxlColorEncoding color;
+            if (dataType == JXL_TYPE_FLOAT) {
+                JxlColorEncodingSetToLinearSRGB(&color, isGray ? JXL_TRUE : JXL_FALSE);
+            } else {
+                JxlColorEncodingSetToSRGB(&color, isGray ? JXL_TRUE : JXL_FALSE);
+            }
+            if (JxlEncoderSetColorEncoding(enc.get(), &color) != JXL_ENC_SUCCESS) {
+                return fail(QString("Failed to set color encoding: %1").arg(encoderError(enc.get())));
+            }
+        }
+
+        JxlEncoderSetFrameDistance(settings, m_distance);
+        if (lossless) {
+            JxlEncoderSetFrameLossless(settings, JXL_TRUE);
+        }
+
+        const JxlPixelFormat format = {static_cast<uint32_t>(channels), dataType, JXL_NATIVE_ENDIAN, 0};
+        if (JxlEncoderAddImageFrame(settings, &format, pixels.constData(), pixels.size()) != JXL_ENC_SUCCESS) {
+            return fail(QString("Failed to add image frame: %1").arg(encoderError(enc.get())));
+        }
+    }
+
+    JxlEncoderCloseInput(enc.get());
+
+    if (cancelled()) {
+        return fail(QString("Cancelled"));
+    }
+
+    std::vector<uint8_t> compressed(64 * 1024);
+    uint8_t *next = compressed.data();
+    size_t avail = compressed.size();
+    JxlEncoderStatus status = JXL_ENC_NEED_MORE_OUTPUT;
+    while (status == JXL_ENC_NEED_MORE_OUTPUT) {
+        status = JxlEncoderProcessOutput(enc.get(), &next, &avail);
+        if (status == JXL_ENC_NEED_MORE_OUTPUT) {
+            if (cancelled()) {
+                return fail(QString("Cancelled"));
+            }
+            const size_t offset = next - compressed.data();
+            compressed.resize(compressed.size() * 2);
+            next = compressed.data() + offset;
+            avail = compressed.size() - offset;
+        }
+    }
+    if (status != JXL_ENC_SUCCESS) {
+        return fail(QString("Encoding failed: %1").arg(encoderError(enc.get())));
+    }
+    compressed.resize(next - compressed.data());
+    const double secs = timer.nsecsElapsed() / 1e9;
+
+    if (cancelled()) {
+        return fail(QString("Cancelled"));
+    }
+
+    // nothing lands on the destination unless the whole file made it
+    QSaveFile outFile(fout);
+    if (!outFile.open(QIODevice::WriteOnly)
+        || outFile.write(reinterpret_cast<const char *>(compressed.data()), compressed.size())
+            != static_cast<qint64>(compressed.size())
+        || !outFile.commit()) {
+        return fail(QString("Failed to write output: %1").arg(outFile.errorString()));
+    }
+
+    result.success = true;
+    result.outputBytes = compressed.size();
+    result.mps = (secs > 0.0) ? (result.pixels / 1e6) / secs : 0.0;
+
+    const double bpp = (result.pixels > 0) ? (compressed.size() * 8.0) / result.pixels : 0.0;
+    result.log = QString("Compressed to %1 bytes (%2 bpp).\n%3 MP, %4 MP/s [in-process, shared runner].")
+                     .arg(QString::number(compressed.size()),
+                          QString::number(bpp, 'f', 3),
+                          QString::number(result.pixels / 1e6, 'f', 3),
+                          QString::number(result.mps, 'f', 3));
+    return result;
+#endif
+}
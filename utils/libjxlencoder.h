@@ -0,0 +1,37 @@
+#ifndef LIBJXLENCODER_H
+#define LIBJXLENCODER_H
+
+#include "libjxlresult.h"
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+/*
+ * Encodes a single file with libjxl linked into the app, so small images
+ * don't pay for a whole cjxl process each. Takes the same option map as
+ * ConversionThread, only the flags that have a frame setting counterpart
+ * are understood, anything else means falling back to cjxl.
+ *
+ * encode() is const and may be called from several threads at once.
+ */
+class LibJxlEncoder
+{
+public:
+    static bool isAvailable();
+    static QString version();
+
+    bool setOptions(const QMap<QString, QString> &opts, QString *reason = nullptr);
+    // cancel is polled between stages, a set flag ends the job early without an output
+    LibJxlResult encode(const QString &fin, const QString &fout, const QAtomicInt *cancel = nullptr) const;
+
+private:
+    float m_distance = 1.0f;
+    bool m_jpegTran = true;
+    QVector<QPair<int, qint64>> m_intSettings;
+    QVector<QPair<int, float>> m_floatSettings;
+};
+
+#endif // LIBJXLENCODER_H
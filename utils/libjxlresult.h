@@ -0,0 +1,21 @@
+#ifndef LIBJXLRESULT_H
+#define LIBJXLRESULT_H
+
+#include <QString>
+
+/*
+ * Outcome of one in-process libjxl job, handed back from the worker pool.
+ * needsBinary means the file is fine but something about it (animation,
+ * an input format Qt can't read...) is better left to cjxl/djxl.
+ */
+struct LibJxlResult
+{
+    bool success{false};
+    bool needsBinary{false};
+    QString log;
+    qint64 pixels{0};
+    qint64 outputBytes{0};
+    double mps{0.0};
+};
+
+#endif // LIBJXLRESULT_H
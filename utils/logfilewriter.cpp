@@ -0,0 +1,267 @@
+#include "logfilewriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+// the writer wakes up early once this much is waiting
+#define FLUSH_BYTES (256 * 1024)
+#define FLUSH_INTERVAL_MS 1000
+// past this the disk isn't keeping up, lines get dropped rather than eating memory
+#define MAX_PENDING_BYTES (32 * 1024 * 1024)
+
+struct Q_DECL_HIDDEN LogFileWriter::Private
+{
+    QString dir;
+    qint64 maxFileBytes = 0;
+    int keepFiles = 0;
+
+    QFile file;
+    qint64 written = 0;
+    QThread *thread = nullptr;
+
+    QMutex mutex;
+    QWaitCondition wake;
+    QByteArray pending;
+    quint64 dropped = 0;
+    bool accepting = false;
+    bool stopping = false;
+
+    QString name(int index) const
+    {
+        if (index == 0) {
+            return QDir(dir).filePath("jxl-batch.log");
+        }
+        return QDir(dir).filePath(QString("jxl-batch.%1.log").arg(QString::number(index)));
+    }
+};
+
+LogFileWriter::LogFileWriter(const QString &dir, qint64 maxFileBytes, int keepFiles)
+    : d(new Private)
+{
+    d->dir = dir;
+    d->maxFileBytes = qMax<qint64>(maxFileBytes, FLUSH_BYTES);
+    d->keepFiles = qMax(keepFiles, 0);
+}
+
+LogFileWriter::~LogFileWriter()
+{
+    close();
+}
+
+bool LogFileWriter::open(QString *error)
+{
+    if (d->thread) {
+        return true;
+    }
+
+    if (!QDir().mkpath(d->dir)) {
+        if (error) {
+            *error = QString("Failed to create %1").arg(d->dir);
+        }
+        return false;
+    }
+
+    // every batch gets a file of its own, the last ones move down the line
+    if (QFileInfo(d->name(0)).size() > 0) {
+        rotate();
+    }
+
+    d->file.setFileName(d->name(0));
+    if (!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) {
+            *error = d->file.errorString();
+        }
+        return false;
+    }
+    d->written = 0;
+
+    d->mutex.lock();
+    d->pending.clear();
+    d->dropped = 0;
+    d->accepting = true;
+    d->stopping = false;
+    d->mutex.unlock();
+
+    d->thread = QThread::create([this]() {
+        writerLoop();
+    });
+    d->thread->start(QThread::LowPriority);
+    return true;
+}
+
+QString LogFileWriter::filePath() const
+{
+    return d->name(0);
+}
+
+void LogFileWriter::write(const QString &text, LogCode code)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+
+    // formatting happens on the caller's side, the lock only covers the append
+    const QByteArray prefix = linePrefix(code);
+    const QByteArray indent(prefix.size(), ' ');
+
+    QByteArray lines;
+    lines.reserve(prefix.size() + text.size() + 16);
+    const QStringList parts = text.split('\n');
+    int count = parts.size();
+    // most messages end with a newline, don't turn it into an empty line
+    while (count > 1 && parts.at(count - 1).isEmpty()) {
+        count--;
+    }
+    for (int i = 0; i < count; i++) {
+        lines.append(i == 0 ? prefix : indent);
+        lines.append(parts.at(i).toUtf8());
+        lines.append('\n');
+    }
+
+    append(lines);
+}
+
+void LogFileWriter::writeResult(LogCode code, const QString &input, const QString &output)
+{
+    QByteArray line = linePrefix(code);
+    line.append(input.toUtf8());
+    if (!output.isEmpty()) {
+        line.append(" -> ");
+        line.append(output.toUtf8());
+    }
+    line.append('\n');
+    append(line);
+}
+
+QByteArray LogFileWriter::linePrefix(LogCode code) const
+{
+    return QString("%1 %2 ").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz"), codeName(code).leftJustified(21)).toUtf8();
+}
+
+void LogFileWriter::append(const QByteArray &lines)
+{
+    d->mutex.lock();
+    if (!d->accepting) {
+        d->mutex.unlock();
+        return;
+    }
+    if (d->pending.size() + lines.size() > MAX_PENDING_BYTES) {
+        d->dropped++;
+        d->mutex.unlock();
+        return;
+    }
+    d->pending.append(lines);
+    const bool full = (d->pending.size() >= FLUSH_BYTES);
+    d->mutex.unlock();
+
+    if (full) {
+        d->wake.wakeOne();
+    }
+}
+
+void LogFileWriter::close()
+{
+    if (!d->thread) {
+        return;
+    }
+
+    d->mutex.lock();
+    d->accepting = false;
+    d->stopping = true;
+    d->mutex.unlock();
+    d->wake.wakeOne();
+
+    d->thread->wait();
+    delete d->thread;
+    d->thread = nullptr;
+}
+
+QString LogFileWriter::codeName(LogCode code)
+{
+    switch (code) {
+    case LogCode::INFO:
+        return QString("INFO");
+    case LogCode::FILE_IN:
+        return QString("FILE_IN");
+    case LogCode::OK:
+        return QString("OK");
+    case LogCode::SKIPPED:
+        return QString("SKIPPED");
+    case LogCode::SKIPPED_ALREADY_EXIST:
+        return QString("SKIPPED_ALREADY_EXIST");
+    case LogCode::SKIPPED_TIMEOUT:
+        return QString("SKIPPED_TIMEOUT");
+    case LogCode::OUT_FOLDER_ERR:
+        return QString("OUT_FOLDER_ERR");
+    case LogCode::ENCODE_ERR_SKIP:
+        return QString("ENCODE_ERR_SKIP");
+    case LogCode::ENCODE_ERR_COPY:
+        return QString("ENCODE_ERR_COPY");
+    case LogCode::ENCODE_ERR_ABORT:
+        return QString("ENCODE_ERR_ABORT");
+    case LogCode::ABORTED:
+        return QString("ABORTED");
+    }
+    return QString::number(static_cast<int>(code));
+}
+
+void LogFileWriter::writerLoop()
+{
+    QByteArray chunk;
+    for (;;) {
+        d->mutex.lock();
+        if (!d->stopping && d->pending.size() < FLUSH_BYTES) {
+            d->wake.wait(&d->mutex, FLUSH_INTERVAL_MS);
+        }
+        chunk.swap(d->pending);
+        const quint64 dropped = d->dropped;
+        d->dropped = 0;
+        const bool stopping = d->stopping;
+        d->mutex.unlock();
+
+        if (dropped > 0) {
+            chunk.append(QString("%1 line(s) not logged, the disk couldn't keep up\n").arg(QString::number(dropped)).toUtf8());
+        }
+
+        if (!chunk.isEmpty()) {
+            if (d->written > 0 && d->written + chunk.size() > d->maxFileBytes) {
+                rotate();
+                d->file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+                d->written = 0;
+            }
+            d->file.write(chunk);
+            d->file.flush();
+            d->written += chunk.size();
+            chunk.clear();
+        }
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    d->file.close();
+}
+
+void LogFileWriter::rotate()
+{
+    d->file.close();
+
+    if (d->keepFiles == 0) {
+        QFile::remove(d->name(0));
+        return;
+    }
+
+    QFile::remove(d->name(d->keepFiles));
+    for (int i = d->keepFiles - 1; i >= 0; i--) {
+        if (QFile::exists(d->name(i))) {
+            QFile::rename(d->name(i), d->name(i + 1));
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef LOGFILEWRITER_H
+#define LOGFILEWRITER_H
+
+#include "logcodes.h"
+
+#include <QScopedPointer>
+#include <QString>
+
+/*
+ * Keeps the whole conversion log on disk, independent of the log widget
+ * (its line limit, silent mode, or whether it keeps up at all).
+ *
+ * write() only formats the line and appends it to an in-memory buffer,
+ * a writer thread of its own swaps the buffer out and puts it on disk in
+ * one go, when enough piled up or about once a second. The file starts
+ * over as jxl-batch.log every batch and once it passes maxFileBytes, the
+ * older ones are kept as jxl-batch.1.log, jxl-batch.2.log... up to
+ * keepFiles.
+ *
+ * Every file's result also gets a line of its own from writeResult(),
+ * built from the code and the paths, so what the widget shows as an
+ * empty line (silent mode, a skipped file) is still on record.
+ */
+class LogFileWriter
+{
+public:
+    LogFileWriter(const QString &dir, qint64 maxFileBytes, int keepFiles);
+    ~LogFileWriter();
+
+    LogFileWriter(const LogFileWriter &v) = delete;
+
+    bool open(QString *error = nullptr);
+    QString filePath() const;
+
+    // thread-safe, never touches the disk
+    void write(const QString &text, LogCode code);
+    void writeResult(LogCode code, const QString &input, const QString &output);
+    // flushes what's left and stops the writer thread
+    void close();
+
+    static QString codeName(LogCode code);
+
+private:
+    QByteArray linePrefix(LogCode code) const;
+    void append(const QByteArray &lines);
+    void writerLoop();
+    void rotate();
+
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // LOGFILEWRITER_H
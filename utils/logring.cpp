@@ -0,0 +1,48 @@
+#include "logring.h"
+
+#include <utility>
+
+LogRing::LogRing(int capacity)
+{
+    // a power of two, so the indices can just keep counting up and wrap
+    quint32 size = 1;
+    while (size < static_cast<quint32>(qMax(capacity, 2))) {
+        size <<= 1;
+    }
+    m_entries.resize(size);
+    m_mask = size - 1;
+}
+
+bool LogRing::push(const QString &text, const QColor &color, LogCode code)
+{
+    const quint32 head = m_head.loadRelaxed();
+    if (head - m_tail.loadAcquire() > m_mask) {
+        m_dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    Entry &entry = m_entries[head & m_mask];
+    entry.text = text;
+    entry.color = color;
+    entry.code = code;
+    // the entry is complete before the consumer can see it
+    m_head.storeRelease(head + 1);
+    return true;
+}
+
+int LogRing::drain(QVector<Entry> &out)
+{
+    const quint32 tail = m_tail.loadRelaxed();
+    const quint32 head = m_head.loadAcquire();
+    for (quint32 i = tail; i != head; i++) {
+        out.append(std::move(m_entries[i & m_mask]));
+    }
+    // hands the slots back to the producer
+    m_tail.storeRelease(head);
+    return static_cast<int>(head - tail);
+}
+
+quint64 LogRing::takeDropped()
+{
+    return m_dropped.fetchAndStoreRelaxed(0);
+}
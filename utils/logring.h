@@ -0,0 +1,49 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include "logcodes.h"
+
+#include <QAtomicInteger>
+#include <QColor>
+#include <QString>
+#include <QVector>
+
+#include <vector>
+
+/*
+ * Log lines of one conversion thread on their way to the GUI.
+ *
+ * One producer (the thread emitting sendLogs) and one consumer (the GUI
+ * timer), neither ever waits on the other. The ring has a fixed size so
+ * a GUI that can't keep up costs dropped lines, counted, instead of an
+ * event queue that grows without limit.
+ */
+class LogRing
+{
+public:
+    struct Entry {
+        QString text;
+        QColor color;
+        LogCode code = LogCode::INFO;
+    };
+
+    explicit LogRing(int capacity = 8192);
+
+    LogRing(const LogRing &v) = delete;
+
+    // producer side, false if the line was dropped
+    bool push(const QString &text, const QColor &color, LogCode code);
+
+    // consumer side
+    int drain(QVector<Entry> &out);
+    quint64 takeDropped();
+
+private:
+    std::vector<Entry> m_entries;
+    quint32 m_mask = 0;
+    QAtomicInteger<quint32> m_head{0};
+    QAtomicInteger<quint32> m_tail{0};
+    QAtomicInteger<quint64> m_dropped{0};
+};
+
+#endif // LOGRING_H
@@ -1,22 +1,48 @@
 #include "logstats.h"
+#include "jobtable.h"
 
 #include <QGlobalStatic>
 #include <QDebug>
 #include <QMutex>
+#include <QVector>
+#include <QtAlgorithms>
 
 Q_GLOBAL_STATIC(LogStats, s_instance)
 
+namespace
+{
+// codes are single bits, a bucket each
+int codeIndex(int code)
+{
+    return qCountTrailingZeroBits(static_cast<quint32>(code));
+}
+} // namespace
+
 struct Q_DECL_HIDDEN LogStats::Private
 {
     QMutex mutex;
+    QSharedPointer<JobTable> jobTable;
+    // a bucket of job indices per code, with a running count so a summary doesn't walk them
+    QVector<quint32> jobs[LogCodeCount];
+    quint64 counts[LogCodeCount] = {};
     quint64 totalFilesProcessed{0};
     quint64 totalInputBytes{0};
     quint64 totalOutputBytes{0};
     double averageMpps{0};
 
-    bool dataAdded{false};
+    QAtomicInt dataAdded{0};
 
-    QList<QPair<QString, LogCode>> fileLists;
+    QList<qint64> workerBusyTimes;
+    quint64 deduplicated{0};
+    quint64 cacheHits{0};
+    quint64 cacheMisses{0};
+    QMap<QString, QPair<quint64, quint64>> copies;
+    // files copied as they are, kept apart from the buckets so they don't count as conversions
+    quint64 mirrored{0};
+    quint64 mirroredBytes{0};
+    quint64 mirrorSkipped{0};
+    QStringList mirrorFailed;
+    QString encoderBackend;
 };
 
 LogStats::LogStats()
@@ -36,9 +62,7 @@ LogStats *LogStats::instance()
 void LogStats::addInputBytes(quint64 v)
 {
     d->mutex.lock();
-    if (!d->dataAdded) {
-        d->dataAdded = true;
-    }
+    d->dataAdded.storeRelaxed(1);
     d->totalInputBytes += v;
     d->mutex.unlock();
 }
@@ -46,9 +70,7 @@ void LogStats::addInputBytes(quint64 v)
 void LogStats::addOutputBytes(quint64 v)
 {
     d->mutex.lock();
-    if (!d->dataAdded) {
-        d->dataAdded = true;
-    }
+    d->dataAdded.storeRelaxed(1);
     d->totalOutputBytes += v;
     d->mutex.unlock();
 }
@@ -56,22 +78,93 @@ void LogStats::addOutputBytes(quint64 v)
 void LogStats::addMpps(double v)
 {
     d->mutex.lock();
-    if (!d->dataAdded) {
-        d->dataAdded = true;
-    }
+    d->dataAdded.storeRelaxed(1);
     // const double mpps = (d->averageMpps + v) / 2.0;
     d->averageMpps += v;
     d->totalFilesProcessed++;
     d->mutex.unlock();
 }
 
-void LogStats::addFiles(const QString &f, LogCode flags)
+void LogStats::setJobTable(const QSharedPointer<JobTable> &jobs)
 {
     d->mutex.lock();
-    if (!d->dataAdded) {
-        d->dataAdded = true;
-    }
-    d->fileLists.append({f, flags});
+    d->jobTable = jobs;
+    d->mutex.unlock();
+}
+
+void LogStats::addJob(int jobIndex, LogCode flags)
+{
+    const int i = codeIndex(flags);
+    d->mutex.lock();
+    d->dataAdded.storeRelaxed(1);
+    d->jobs[i].append(static_cast<quint32>(jobIndex));
+    d->counts[i]++;
+    d->mutex.unlock();
+}
+
+void LogStats::addWorkerBusyTime(qint64 ms)
+{
+    d->mutex.lock();
+    d->workerBusyTimes.append(ms);
+    d->mutex.unlock();
+}
+
+void LogStats::addDeduplicated()
+{
+    d->mutex.lock();
+    d->deduplicated++;
+    d->mutex.unlock();
+}
+
+void LogStats::addCacheHit()
+{
+    d->mutex.lock();
+    d->cacheHits++;
+    d->mutex.unlock();
+}
+
+void LogStats::addCacheMiss()
+{
+    d->mutex.lock();
+    d->cacheMisses++;
+    d->mutex.unlock();
+}
+
+void LogStats::addCopy(const QString &strategy, qint64 bytes)
+{
+    d->mutex.lock();
+    QPair<quint64, quint64> &v = d->copies[strategy];
+    v.first++;
+    v.second += bytes;
+    d->mutex.unlock();
+}
+
+void LogStats::addMirrored(qint64 bytes)
+{
+    d->mutex.lock();
+    d->mirrored++;
+    d->mirroredBytes += bytes;
+    d->mutex.unlock();
+}
+
+void LogStats::addMirrorSkipped()
+{
+    d->mutex.lock();
+    d->mirrorSkipped++;
+    d->mutex.unlock();
+}
+
+void LogStats::addMirrorFailed(const QString &f)
+{
+    d->mutex.lock();
+    d->mirrorFailed.append(f);
+    d->mutex.unlock();
+}
+
+void LogStats::setEncoderBackend(const QString &name)
+{
+    d->mutex.lock();
+    d->encoderBackend = name;
     d->mutex.unlock();
 }
 
@@ -101,68 +194,155 @@ double LogStats::readAverageMpps() const
 
 QStringList LogStats::readFiles(LogCode flags) const
 {
-    QStringList files;
-    foreach (const auto &fl, d->fileLists) {
-        if (fl.second == flags) {
-            files.append(fl.first);
-        }
-    }
-    return files;
+    return readFiles(static_cast<int>(flags));
 }
 
 QStringList LogStats::readFiles(int flags) const
 {
     QStringList files;
-    foreach (const auto &fl, d->fileLists) {
-        if (fl.second & flags) {
-            files.append(fl.first);
+    d->mutex.lock();
+    if (d->jobTable) {
+        for (int i = 0; i < LogCodeCount; i++) {
+            if (flags & (1 << i)) {
+                for (const quint32 job : qAsConst(d->jobs[i])) {
+                    files.append(d->jobTable->path(static_cast<int>(job)));
+                }
+            }
         }
     }
+    d->mutex.unlock();
     return files;
 }
 
 quint64 LogStats::countFiles(LogCode flags) const
 {
-    quint64 files = 0;
-    foreach (const auto &fl, d->fileLists) {
-        if (fl.second == flags) {
-            files++;
-        }
-    }
-    return files;
+    return countFiles(static_cast<int>(flags));
 }
 
 quint64 LogStats::countFiles(int flags) const
 {
-
+    // running counters, no list is walked
     if (flags == 0) {
-        return d->fileLists.size();
+        flags = (1 << LogCodeCount) - 1;
     }
     quint64 files = 0;
-    foreach (const auto &fl, d->fileLists) {
-        if (fl.second & flags) {
-            files++;
+    d->mutex.lock();
+    for (int i = 0; i < LogCodeCount; i++) {
+        if (flags & (1 << i)) {
+            files += d->counts[i];
         }
     }
+    d->mutex.unlock();
     return files;
 }
 
+QList<qint64> LogStats::readWorkerBusyTimes() const
+{
+    d->mutex.lock();
+    const QList<qint64> v = d->workerBusyTimes;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readDeduplicated() const
+{
+    d->mutex.lock();
+    const quint64 v = d->deduplicated;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readCacheHits() const
+{
+    d->mutex.lock();
+    const quint64 v = d->cacheHits;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readCacheMisses() const
+{
+    d->mutex.lock();
+    const quint64 v = d->cacheMisses;
+    d->mutex.unlock();
+    return v;
+}
+
+QMap<QString, QPair<quint64, quint64>> LogStats::readCopies() const
+{
+    d->mutex.lock();
+    const QMap<QString, QPair<quint64, quint64>> v = d->copies;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readMirrored() const
+{
+    d->mutex.lock();
+    const quint64 v = d->mirrored;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readMirroredBytes() const
+{
+    d->mutex.lock();
+    const quint64 v = d->mirroredBytes;
+    d->mutex.unlock();
+    return v;
+}
+
+quint64 LogStats::readMirrorSkipped() const
+{
+    d->mutex.lock();
+    const quint64 v = d->mirrorSkipped;
+    d->mutex.unlock();
+    return v;
+}
+
+QStringList LogStats::readMirrorFailed() const
+{
+    d->mutex.lock();
+    const QStringList v = d->mirrorFailed;
+    d->mutex.unlock();
+    return v;
+}
+
+QString LogStats::readEncoderBackend() const
+{
+    d->mutex.lock();
+    const QString v = d->encoderBackend;
+    d->mutex.unlock();
+    return v;
+}
+
 void LogStats::resetValues()
 {
     d->mutex.lock();
-    d->dataAdded = false;
+    for (int i = 0; i < LogCodeCount; i++) {
+        d->jobs[i].clear();
+        d->counts[i] = 0;
+    }
+    d->jobTable.reset();
+    d->dataAdded.storeRelaxed(0);
     d->totalOutputBytes = 0;
     d->totalInputBytes = 0;
     d->averageMpps = 0;
     d->totalFilesProcessed = 0;
-    d->fileLists.clear();
+    d->workerBusyTimes.clear();
+    d->deduplicated = 0;
+    d->cacheHits = 0;
+    d->cacheMisses = 0;
+    d->copies.clear();
+    d->mirrored = 0;
+    d->mirroredBytes = 0;
+    d->mirrorSkipped = 0;
+    d->mirrorFailed.clear();
+    d->encoderBackend.clear();
     d->mutex.unlock();
 }
 
 bool LogStats::isDataValid() const
 {
-    d->mutex.lock();
-    const bool valid = d->dataAdded;
-    d->mutex.unlock();
-    return valid;
+    return d->dataAdded.loadRelaxed() != 0;
 }
@@ -3,9 +3,14 @@
 
 #include "logcodes.h"
 
+#include <QMap>
+#include <QPair>
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include <QStringList>
 
+class JobTable;
+
 class LogStats
 {
 public:
@@ -19,7 +24,18 @@ public:
     void addInputBytes(quint64 v);
     void addOutputBytes(quint64 v);
     void addMpps(double v);
-    void addFiles(const QString &f, LogCode flags);
+    // results are kept as job indices, readFiles() turns them back into paths
+    void setJobTable(const QSharedPointer<JobTable> &jobs);
+    void addJob(int jobIndex, LogCode flags);
+    void addWorkerBusyTime(qint64 ms);
+    void addDeduplicated();
+    void addCacheHit();
+    void addCacheMiss();
+    void addCopy(const QString &strategy, qint64 bytes);
+    void addMirrored(qint64 bytes);
+    void addMirrorSkipped();
+    void addMirrorFailed(const QString &f);
+    void setEncoderBackend(const QString &name);
 
     quint64 readTotalInputBytes() const;
     quint64 readTotalOutputBytes() const;
@@ -28,6 +44,17 @@ public:
     QStringList readFiles(int flags) const;
     quint64 countFiles(LogCode flags) const;
     quint64 countFiles(int flags = 0) const;
+    QList<qint64> readWorkerBusyTimes() const;
+    quint64 readDeduplicated() const;
+    quint64 readCacheHits() const;
+    quint64 readCacheMisses() const;
+    // strategy name -> (number of copies, bytes moved)
+    QMap<QString, QPair<quint64, quint64>> readCopies() const;
+    quint64 readMirrored() const;
+    quint64 readMirroredBytes() const;
+    quint64 readMirrorSkipped() const;
+    QStringList readMirrorFailed() const;
+    QString readEncoderBackend() const;
 
     void resetValues();
     bool isDataValid() const;
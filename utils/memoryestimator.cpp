@@ -0,0 +1,102 @@
+#include "memoryestimator.h"
+
+#include <QFile>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// fixed cost of a process regardless of the image (binary, libs, thread stacks)
+#define PROCESS_OVERHEAD_BYTES (64LL * 1024 * 1024)
+// samples on tiny images are mostly overhead and say nothing about bytes per pixel
+#define MIN_SAMPLE_PIXELS (1000 * 1000)
+// weight of a new sample in the running estimate
+#define SAMPLE_WEIGHT 0.3
+// headroom on top of the learned figure
+#define SAFETY_FACTOR 1.2
+
+MemoryEstimator::MemoryEstimator()
+{
+    reset(7);
+}
+
+void MemoryEstimator::reset(int effort)
+{
+    // rough starting point for 8-bit input, higher efforts keep more buffers around
+    m_bytesPerPixel = 24.0 + 8.0 * std::max(std::min(effort, 10), 1);
+    m_samples = 0;
+}
+
+qint64 MemoryEstimator::estimate(qint64 pixels, int bitDepth) const
+{
+    // wider samples mostly cost on the decoded input side
+    const double depthFactor = (bitDepth > 8) ? 1.25 : 1.0;
+    const double bytes = static_cast<double>(pixels) * m_bytesPerPixel * depthFactor;
+    return PROCESS_OVERHEAD_BYTES + static_cast<qint64>(bytes * (m_samples > 0 ? SAFETY_FACTOR : 1.0));
+}
+
+void MemoryEstimator::addSample(qint64 pixels, int bitDepth, qint64 peakRss)
+{
+    if (pixels < MIN_SAMPLE_PIXELS || peakRss <= PROCESS_OVERHEAD_BYTES) {
+        return;
+    }
+
+    const double depthFactor = (bitDepth > 8) ? 1.25 : 1.0;
+    const double observed = static_cast<double>(peakRss - PROCESS_OVERHEAD_BYTES) / static_cast<double>(pixels) / depthFactor;
+
+    if (m_samples == 0) {
+        m_bytesPerPixel = observed;
+    } else {
+        // rising fast and falling slowly keeps us on the safe side
+        const double weight = (observed > m_bytesPerPixel) ? 0.5 : SAMPLE_WEIGHT;
+        m_bytesPerPixel = m_bytesPerPixel * (1.0 - weight) + observed * weight;
+    }
+    m_samples++;
+}
+
+qint64 MemoryEstimator::readPeakRss(qint64 pid)
+{
+    if (pid <= 0) {
+        return 0;
+    }
+
+#if defined(Q_OS_LINUX)
+    QFile status(QString("/proc/%1/status").arg(QString::number(pid)));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    static const QRegularExpression regHwm("VmHWM:\\s*(\\d+)\\s*kB");
+    const QRegularExpressionMatch hwm = regHwm.match(QString::fromLatin1(status.readAll()));
+    if (hwm.hasMatch()) {
+        return hwm.captured(1).toLongLong() * 1024;
+    }
+#elif defined(Q_OS_WIN)
+    HANDLE proc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    if (proc) {
+        PROCESS_MEMORY_COUNTERS pmc;
+        qint64 peak = 0;
+        if (GetProcessMemoryInfo(proc, &pmc, sizeof(pmc))) {
+            peak = static_cast<qint64>(pmc.PeakWorkingSetSize);
+        }
+        CloseHandle(proc);
+        return peak;
+    }
+#endif
+
+    return 0;
+}
+
+void MemoryEstimator::resetOwnPeakRss()
+{
+    // lets a long-lived worker report per-job peaks, elsewhere the peak just keeps growing
+#if defined(Q_OS_LINUX)
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly)) {
+        clearRefs.write("5");
+    }
+#endif
+}
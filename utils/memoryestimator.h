@@ -0,0 +1,28 @@
+#ifndef MEMORYESTIMATOR_H
+#define MEMORYESTIMATOR_H
+
+#include <QtGlobal>
+
+/*
+ * Guesses the peak memory of one encoder process from the image size,
+ * bit depth and effort, and refines the guess with the peak RSS measured
+ * on finished processes.
+ */
+class MemoryEstimator
+{
+public:
+    MemoryEstimator();
+
+    void reset(int effort);
+    qint64 estimate(qint64 pixels, int bitDepth) const;
+    void addSample(qint64 pixels, int bitDepth, qint64 peakRss);
+
+    static qint64 readPeakRss(qint64 pid);
+    static void resetOwnPeakRss();
+
+private:
+    double m_bytesPerPixel = 0.0;
+    int m_samples = 0;
+};
+
+#endif // MEMORYESTIMATOR_H
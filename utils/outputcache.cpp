@@ -0,0 +1,169 @@
+#include "outputcache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+bool OutputCache::open(const QString &dir, qint64 limitBytes)
+{
+    close();
+
+    if (dir.isEmpty() || limitBytes <= 0 || !QDir().mkpath(dir)) {
+        return false;
+    }
+    m_dir = QDir::cleanPath(dir);
+    m_limit = limitBytes;
+
+    // one listing up front, lookups after that never touch the disk unless they hit
+    QDirIterator it(m_dir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        // leftovers of a store that got killed halfway
+        if (info.fileName().contains('.')) {
+            if (info.lastModified().secsTo(QDateTime::currentDateTime()) > 3600) {
+                QFile::remove(info.absoluteFilePath());
+            }
+            continue;
+        }
+        Entry entry;
+        entry.size = info.size();
+        entry.lastUse = info.lastModified().toMSecsSinceEpoch();
+        m_entries.insert(info.fileName().toLatin1(), entry);
+        m_total += entry.size;
+    }
+
+    trim();
+    return true;
+}
+
+void OutputCache::close()
+{
+    m_dir.clear();
+    m_limit = 0;
+    m_total = 0;
+    m_entries.clear();
+}
+
+bool OutputCache::isOpen() const
+{
+    return !m_dir.isEmpty();
+}
+
+QByteArray OutputCache::key(const QByteArray &contentHash, const QString &encoder, const QString &encodeHash, const QString &extension)
+{
+    if (contentHash.isEmpty()) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(contentHash);
+    hash.addData(encoder.toUtf8() + '\0');
+    hash.addData(encodeHash.toUtf8() + '\0');
+    hash.addData(extension.toLower().toUtf8());
+    return hash.result().toHex();
+}
+
+FileCopy::Result OutputCache::fetch(const QByteArray &key, const QString &target)
+{
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return FileCopy::Result();
+    }
+
+    const QString path = pathFor(key);
+    const FileCopy::Result result = FileCopy::copy(path, target);
+    if (!result.success) {
+        // someone else trimmed it
+        if (!QFile::exists(path)) {
+            m_total -= it.value().size;
+            m_entries.erase(it);
+        }
+        return result;
+    }
+
+    const QDateTime now = QDateTime::currentDateTime();
+    QFile entryFile(path);
+    if (entryFile.open(QIODevice::ReadWrite)) {
+        entryFile.setFileTime(now, QFileDevice::FileModificationTime);
+    }
+    it.value().lastUse = now.toMSecsSinceEpoch();
+    return result;
+}
+
+FileCopy::Result OutputCache::store(const QByteArray &key, const QString &source)
+{
+    if (!isOpen() || key.isEmpty() || m_entries.contains(key)) {
+        return FileCopy::Result();
+    }
+
+    const qint64 size = QFileInfo(source).size();
+    // one output bigger than the whole cache would just push everything else out
+    if (size <= 0 || size > m_limit / 4) {
+        return FileCopy::Result();
+    }
+
+    const QString path = pathFor(key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    const QString temp = QString("%1.%2.tmp").arg(path, QString::number(QCoreApplication::applicationPid()));
+    QFile::remove(temp);
+    FileCopy::Result result = FileCopy::copy(source, temp);
+    if (!result.success) {
+        return result;
+    }
+    // QFile::rename won't replace, an instance racing us to the same key has the same bytes anyway
+    if (!QFile::rename(temp, path)) {
+        QFile::remove(temp);
+        if (!QFile::exists(path)) {
+            result.success = false;
+            return result;
+        }
+    }
+
+    Entry entry;
+    entry.size = size;
+    entry.lastUse = QDateTime::currentMSecsSinceEpoch();
+    m_entries.insert(key, entry);
+    m_total += size;
+
+    trim();
+    return result;
+}
+
+QString OutputCache::pathFor(const QByteArray &key) const
+{
+    const QString name = QString::fromLatin1(key);
+    return m_dir + QDir::separator() + name.left(2) + QDir::separator() + name;
+}
+
+void OutputCache::trim()
+{
+    if (m_total <= m_limit) {
+        return;
+    }
+
+    // down to 90% so the next few stores don't each trigger a sort
+    const qint64 target = m_limit - m_limit / 10;
+    std::vector<std::pair<qint64, QByteArray>> byAge;
+    byAge.reserve(m_entries.size());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        byAge.emplace_back(it.value().lastUse, it.key());
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    for (const auto &oldest : byAge) {
+        if (m_total <= target) {
+            break;
+        }
+        QFile::remove(pathFor(oldest.second));
+        m_total -= m_entries.value(oldest.second).size;
+        m_entries.remove(oldest.second);
+    }
+}
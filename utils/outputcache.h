@@ -0,0 +1,53 @@
+#ifndef OUTPUTCACHE_H
+#define OUTPUTCACHE_H
+
+#include "filecopy.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+/*
+ * Encoded outputs kept around between runs, shared by every batch on this
+ * machine. An entry is keyed by the input's content hash, the encoder
+ * version, the option hash and the output extension, so the same source
+ * converted with the same settings into another folder is a copy instead
+ * of an encode. Copies in and out are reflinks where the filesystem can.
+ *
+ * Entries are plain files in two-level folders, a hit bumps the file's
+ * mtime and that's what the LRU trimming goes by, so it survives restarts
+ * and other instances sharing the folder. Stores land through a temporary
+ * file and a rename, a reader never sees half an entry.
+ *
+ * Not thread-safe, it lives on ConversionThread's loop.
+ */
+class OutputCache
+{
+public:
+    bool open(const QString &dir, qint64 limitBytes);
+    void close();
+    bool isOpen() const;
+
+    // contentHash is ContentDedup::hashFile() of the input, read once for the duplicate check too
+    static QByteArray key(const QByteArray &contentHash, const QString &encoder, const QString &encodeHash, const QString &extension);
+
+    // success is false on a miss
+    FileCopy::Result fetch(const QByteArray &key, const QString &target);
+    FileCopy::Result store(const QByteArray &key, const QString &source);
+
+private:
+    struct Entry {
+        qint64 size = 0;
+        qint64 lastUse = 0;
+    };
+
+    QString pathFor(const QByteArray &key) const;
+    void trim();
+
+    QString m_dir;
+    qint64 m_limit = 0;
+    qint64 m_total = 0;
+    QHash<QByteArray, Entry> m_entries;
+};
+
+#endif // OUTPUTCACHE_H
@@ -0,0 +1,168 @@
+#include "outputdircache.h"
+
+#include <QDir>
+
+namespace
+{
+// match what the filesystem would call the same file
+inline QString nameKey(const QString &fileName)
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    return fileName.toLower();
+#else
+    return fileName;
+#endif
+}
+} // namespace
+
+OutputDirCache::OutputDirCache(const QString &outputRoot, const QString &inputBase)
+    : m_outputRoot(outputRoot)
+    , m_inputBase(inputBase)
+{
+}
+
+void OutputDirCache::setSkipExisting(bool skip)
+{
+    m_skipExisting = skip;
+}
+
+QString OutputDirCache::outputDirFor(const QString &inputDir) const
+{
+    if (m_inputBase.isEmpty()) {
+        return QDir::cleanPath(m_outputRoot);
+    }
+
+    const QString extraDirName =
+        inputDir.startsWith(m_inputBase) ? inputDir.mid(m_inputBase.size()) : QString(inputDir).remove(m_inputBase);
+    return QDir::cleanPath(m_outputRoot + extraDirName);
+}
+
+bool OutputDirCache::ensure(const QString &outputDir)
+{
+    m_lock.lockForRead();
+    const bool known = m_known.contains(outputDir);
+    m_lock.unlock();
+
+    if (known) {
+        return true;
+    }
+
+    // mkpath is fine with the folder showing up from another thread meanwhile
+    const QDir dir(outputDir);
+    const bool existed = dir.exists();
+    if (!existed && !dir.mkpath(".") && !dir.exists()) {
+        return false;
+    }
+
+    if (m_skipExisting) {
+        listFolder(outputDir, !existed);
+    }
+
+    m_lock.lockForWrite();
+    m_known.insert(outputDir);
+    if (!existed) {
+        m_created++;
+    }
+    m_lock.unlock();
+    return true;
+}
+
+bool OutputDirCache::claimFile(const QString &outputDir, const QString &fileName)
+{
+    m_lock.lockForRead();
+    const bool listed = m_names.contains(outputDir);
+    m_lock.unlock();
+
+    if (!listed) {
+        listFolder(outputDir, false);
+    }
+
+    // two inputs with the same base name land on the same output, only the first one gets it
+    QWriteLocker locker(&m_lock);
+    QSet<QString> &names = m_names[outputDir];
+    const QString key = nameKey(fileName);
+    if (names.contains(key)) {
+        return false;
+    }
+    names.insert(key);
+    m_claimed[outputDir].insert(key);
+    return true;
+}
+
+bool OutputDirCache::claimExisting(const QString &outputDir, const QString &fileName)
+{
+    QWriteLocker locker(&m_lock);
+    QSet<QString> &claimed = m_claimed[outputDir];
+    const QString key = nameKey(fileName);
+    if (claimed.contains(key)) {
+        return false;
+    }
+    claimed.insert(key);
+    m_names[outputDir].insert(key);
+    return true;
+}
+
+bool OutputDirCache::claimMirror(const QString &outputDir, const QString &fileName)
+{
+    m_lock.lockForRead();
+    const bool listed = m_names.contains(outputDir);
+    m_lock.unlock();
+
+    if (!listed) {
+        listFolder(outputDir, false);
+    }
+
+    // what's on disk or claimed by a conversion is left alone
+    QWriteLocker locker(&m_lock);
+    const QString key = nameKey(fileName);
+    if (m_names.value(outputDir).contains(key)) {
+        return false;
+    }
+    QSet<QString> &mirrored = m_mirrored[outputDir];
+    if (mirrored.contains(key)) {
+        return false;
+    }
+    mirrored.insert(key);
+    return true;
+}
+
+void OutputDirCache::releaseFile(const QString &outputDir, const QString &fileName)
+{
+    // only called once the file is gone, so this never forgets one that's still on disk
+    QWriteLocker locker(&m_lock);
+    const QString key = nameKey(fileName);
+    const auto claimed = m_claimed.find(outputDir);
+    if (claimed == m_claimed.end() || !claimed->remove(key)) {
+        return;
+    }
+    const auto names = m_names.find(outputDir);
+    if (names != m_names.end()) {
+        names->remove(key);
+    }
+}
+
+int OutputDirCache::created() const
+{
+    QReadLocker locker(&m_lock);
+    return m_created;
+}
+
+void OutputDirCache::listFolder(const QString &outputDir, bool isNew)
+{
+    // one listing instead of a stat per file, a folder made just now has nothing to list
+    QSet<QString> names;
+    if (!isNew) {
+        const QStringList entries =
+            QDir(outputDir).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        names.reserve(entries.size());
+        for (const QString &entry : entries) {
+            names.insert(nameKey(entry));
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    // whatever the mirror put there meanwhile isn't an output a conversion has to keep away from
+    names.subtract(m_mirrored.value(outputDir));
+    // another thread may have listed it meanwhile, keep what it claimed too
+    m_names[outputDir].unite(names);
+}
@@ -0,0 +1,61 @@
+#ifndef OUTPUTDIRCACHE_H
+#define OUTPUTDIRCACHE_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+
+/*
+ * Output folders of one batch, mirrored from the input tree.
+ *
+ * The folder scan creates each folder as soon as it finds files for it,
+ * workers then only look the folder up here instead of hitting the disk,
+ * and a folder is only ever created by whoever gets to it first.
+ *
+ * With skip-existing on, each folder is also listed once when it's first
+ * seen, and claimFile() answers "is this output already there" from that
+ * listing plus whatever the batch itself claimed so far. A failed
+ * conversion hands its name back with releaseFile(). claimExisting()
+ * takes over a file that was there before the batch, for an output that
+ * has to be redone, but never one another input of the batch claimed.
+ *
+ * Files copied over by the mirror are claimed with claimMirror(), apart
+ * from the conversions: a mirrored file never keeps a conversion from its
+ * output name, the conversion just writes over it.
+ *
+ * An empty input base means a flat output, everything goes to the root.
+ */
+class OutputDirCache
+{
+public:
+    explicit OutputDirCache(const QString &outputRoot, const QString &inputBase = QString());
+
+    OutputDirCache(const OutputDirCache &v) = delete;
+
+    void setSkipExisting(bool skip);
+
+    QString outputDirFor(const QString &inputDir) const;
+    bool ensure(const QString &outputDir);
+    bool claimFile(const QString &outputDir, const QString &fileName);
+    bool claimExisting(const QString &outputDir, const QString &fileName);
+    bool claimMirror(const QString &outputDir, const QString &fileName);
+    void releaseFile(const QString &outputDir, const QString &fileName);
+    int created() const;
+
+private:
+    void listFolder(const QString &outputDir, bool isNew);
+
+    QString m_outputRoot;
+    QString m_inputBase;
+    bool m_skipExisting = false;
+
+    mutable QReadWriteLock m_lock;
+    QSet<QString> m_known;
+    QHash<QString, QSet<QString>> m_names;
+    QHash<QString, QSet<QString>> m_claimed;
+    QHash<QString, QSet<QString>> m_mirrored;
+    int m_created = 0;
+};
+
+#endif // OUTPUTDIRCACHE_H
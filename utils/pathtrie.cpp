@@ -0,0 +1,59 @@
+#include "pathtrie.h"
+
+#include <QDir>
+
+PathTrie::PathTrie()
+{
+    // node 0 is the root
+    m_nodes.append(Node());
+}
+
+void PathTrie::insert(const QString &path)
+{
+    const QStringList parts = QDir::cleanPath(path).split('/', Qt::SkipEmptyParts);
+    if (parts.isEmpty()) {
+        return;
+    }
+
+    int node = 0;
+    for (const QString &part : parts) {
+        const auto it = m_nodes.at(node).children.constFind(part);
+        if (it != m_nodes.at(node).children.constEnd()) {
+            node = it.value();
+        } else {
+            const int child = m_nodes.size();
+            m_nodes.append(Node());
+            m_nodes[node].children.insert(part, child);
+            node = child;
+        }
+    }
+    m_nodes[node].terminal = true;
+}
+
+bool PathTrie::covers(const QString &path) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+
+    const QStringList parts = QDir::cleanPath(path).split('/', Qt::SkipEmptyParts);
+
+    int node = 0;
+    for (const QString &part : parts) {
+        const auto it = m_nodes.at(node).children.constFind(part);
+        if (it == m_nodes.at(node).children.constEnd()) {
+            return false;
+        }
+        node = it.value();
+        // the folder itself or anything below it
+        if (m_nodes.at(node).terminal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PathTrie::isEmpty() const
+{
+    return m_nodes.size() == 1;
+}
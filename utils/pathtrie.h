@@ -0,0 +1,31 @@
+#ifndef PATHTRIE_H
+#define PATHTRIE_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/*
+ * Set of folders keyed by path component, answers "is this path inside
+ * one of them" in one walk down the path, no matter how many folders
+ * were added. Paths are compared after QDir::cleanPath, case-sensitively.
+ */
+class PathTrie
+{
+public:
+    PathTrie();
+
+    void insert(const QString &path);
+    bool covers(const QString &path) const;
+    bool isEmpty() const;
+
+private:
+    struct Node {
+        QHash<QString, int> children;
+        bool terminal = false;
+    };
+
+    QVector<Node> m_nodes;
+};
+
+#endif // PATHTRIE_H
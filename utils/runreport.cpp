@@ -0,0 +1,120 @@
+#include "runreport.h"
+#include "logfilewriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+namespace
+{
+const char *const csvHeader =
+    "finished,input,output,input_size,output_size,encode_hash,encoder,backend,exit_code,log_code,wall_ms,mps,timed_out,aborted\n";
+
+QString csvField(const QString &value)
+{
+    if (!value.contains(',') && !value.contains('"') && !value.contains('\n') && !value.contains('\r')) {
+        return value;
+    }
+    QString quoted = value;
+    quoted.replace("\"", "\"\"");
+    return QString("\"%1\"").arg(quoted);
+}
+} // namespace
+
+bool RunReport::open(const QString &outputRoot, Format format, const QString &encodeHash, const QString &encoder)
+{
+    close();
+
+    m_format = format;
+    m_encodeHash = encodeHash;
+    m_encoder = encoder;
+
+    // one file per run, an earlier report is never appended to or overwritten
+    const QString stamp = QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
+    const QString ext = (format == Format::Csv) ? QString("csv") : QString("jsonl");
+    QString name = QString("jxl-batch-report-%1.%2").arg(stamp, ext);
+    for (int i = 2; QFile::exists(QDir(outputRoot).filePath(name)); i++) {
+        name = QString("jxl-batch-report-%1-%2.%3").arg(stamp, QString::number(i), ext);
+    }
+
+    m_file.setFileName(QDir(outputRoot).filePath(name));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+        return false;
+    }
+    if (m_format == Format::Csv) {
+        m_file.write(csvHeader);
+        m_file.flush();
+    }
+    return true;
+}
+
+void RunReport::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+bool RunReport::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString RunReport::filePath() const
+{
+    return m_file.fileName();
+}
+
+void RunReport::record(const Row &row)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    const QString finished = QDateTime::currentDateTime().toString(Qt::ISODateWithMs);
+    const QString code = LogFileWriter::codeName(row.code);
+    // rounded, the encoders don't report more than that anyway
+    const double mps = (row.mps >= 0.0) ? qRound64(row.mps * 1000.0) / 1000.0 : -1.0;
+
+    QByteArray line;
+    if (m_format == Format::Csv) {
+        const QStringList fields = {finished,
+                                    csvField(row.input),
+                                    csvField(row.output),
+                                    QString::number(row.inputSize),
+                                    QString::number(row.outputSize),
+                                    csvField(m_encodeHash),
+                                    csvField(m_encoder),
+                                    csvField(row.backend),
+                                    QString::number(row.exitCode),
+                                    code,
+                                    QString::number(row.wallMs),
+                                    QString::number(mps),
+                                    row.timedOut ? QString("1") : QString("0"),
+                                    row.aborted ? QString("1") : QString("0")};
+        line = fields.join(',').toUtf8() + '\n';
+    } else {
+        QJsonObject obj;
+        obj.insert("finished", finished);
+        obj.insert("input", row.input);
+        obj.insert("output", row.output);
+        obj.insert("inputSize", static_cast<double>(row.inputSize));
+        obj.insert("outputSize", static_cast<double>(row.outputSize));
+        obj.insert("encodeHash", m_encodeHash);
+        obj.insert("encoder", m_encoder);
+        obj.insert("backend", row.backend);
+        obj.insert("exitCode", row.exitCode);
+        obj.insert("logCode", code);
+        obj.insert("wallMs", static_cast<double>(row.wallMs));
+        obj.insert("mps", mps);
+        obj.insert("timedOut", row.timedOut);
+        obj.insert("aborted", row.aborted);
+        line = QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+    }
+
+    // flushed per file like the manifest, a killed run keeps what it got through
+    m_file.write(line);
+    m_file.flush();
+}
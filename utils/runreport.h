@@ -0,0 +1,54 @@
+#ifndef RUNREPORT_H
+#define RUNREPORT_H
+
+#include "logcodes.h"
+
+#include <QFile>
+#include <QString>
+
+/*
+ * Per-file results of a batch in a form scripts can read, as JSON lines
+ * or CSV with a header row. Written next to the outputs while the batch
+ * runs, one row per file as soon as it's done with, so an interrupted
+ * run still leaves everything up to that point.
+ *
+ * Sizes, exit code, wall time and MP/s are -1 where they don't apply,
+ * e.g. a skipped file never ran an encoder.
+ */
+class RunReport
+{
+public:
+    enum class Format {
+        Jsonl,
+        Csv
+    };
+
+    struct Row {
+        QString input;
+        QString output;
+        QString backend;
+        qint64 inputSize = -1;
+        qint64 outputSize = -1;
+        qint64 wallMs = -1;
+        double mps = -1.0;
+        int exitCode = -1;
+        LogCode code = LogCode::INFO;
+        bool timedOut = false;
+        bool aborted = false;
+    };
+
+    bool open(const QString &outputRoot, Format format, const QString &encodeHash, const QString &encoder);
+    void close();
+    bool isOpen() const;
+    QString filePath() const;
+
+    void record(const Row &row);
+
+private:
+    QFile m_file;
+    Format m_format = Format::Jsonl;
+    QString m_encodeHash;
+    QString m_encoder;
+};
+
+#endif // RUNREPORT_H
@@ -0,0 +1,178 @@
+#include "sharedparallelrunner.h"
+
+#include <QGlobalStatic>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
+
+Q_GLOBAL_STATIC(SharedParallelRunner, s_instance)
+
+namespace
+{
+// one parallel-for call from libjxl, lives on the caller's stack
+struct Task {
+    void *jpegxlOpaque = nullptr;
+    JxlParallelRunFunction func = nullptr;
+    std::atomic<uint64_t> next{0};
+    uint64_t end = 0;
+    size_t numThreads = 1;
+    // guarded by the runner mutex, thread id 0 belongs to the caller
+    size_t nextThreadId = 1;
+    int helpers = 0;
+
+    void work(size_t threadId)
+    {
+        uint64_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < end) {
+            func(jpegxlOpaque, static_cast<uint32_t>(i), threadId);
+        }
+    }
+};
+} // namespace
+
+struct Q_DECL_HIDDEN SharedParallelRunner::Private
+{
+    mutable QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition helpersDone;
+    QList<Task *> tasks;
+    QVector<QThread *> workers;
+    int workerCount{0};
+    bool stopping{false};
+
+    void workerLoop(int index);
+};
+
+void SharedParallelRunner::Private::workerLoop(int index)
+{
+    mutex.lock();
+    while (!stopping) {
+        // join the task with the fewest helpers so the cores spread over the images in flight
+        Task *task = nullptr;
+        for (Task *t : qAsConst(tasks)) {
+            if (index >= workerCount) {
+                break;
+            }
+            if (t->nextThreadId < t->numThreads && t->next.load(std::memory_order_relaxed) < t->end
+                && (!task || t->helpers < task->helpers)) {
+                task = t;
+            }
+        }
+        if (!task) {
+            workAvailable.wait(&mutex);
+            continue;
+        }
+
+        const size_t threadId = task->nextThreadId++;
+        task->helpers++;
+        mutex.unlock();
+
+        task->work(threadId);
+
+        mutex.lock();
+        task->helpers--;
+        if (task->helpers == 0) {
+            helpersDone.wakeAll();
+        }
+    }
+    mutex.unlock();
+}
+
+SharedParallelRunner::SharedParallelRunner()
+    : d(new Private)
+{
+}
+
+SharedParallelRunner::~SharedParallelRunner()
+{
+    d->mutex.lock();
+    d->stopping = true;
+    d->workAvailable.wakeAll();
+    d->mutex.unlock();
+
+    for (QThread *worker : qAsConst(d->workers)) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+SharedParallelRunner *SharedParallelRunner::instance()
+{
+    return s_instance;
+}
+
+void SharedParallelRunner::setWorkerCount(int workers)
+{
+    d->mutex.lock();
+    d->workerCount = std::max(workers, 0);
+    while (d->workers.size() < d->workerCount) {
+        const int index = d->workers.size();
+        QThread *worker = QThread::create([this, index]() {
+            d->workerLoop(index);
+        });
+        worker->start();
+        d->workers.append(worker);
+    }
+    d->mutex.unlock();
+}
+
+int SharedParallelRunner::workerCount() const
+{
+    d->mutex.lock();
+    const int v = d->workerCount;
+    d->mutex.unlock();
+    return v;
+}
+
+JxlParallelRetCode SharedParallelRunner::run(void *runnerOpaque,
+                                             void *jpegxlOpaque,
+                                             JxlParallelRunInit init,
+                                             JxlParallelRunFunction func,
+                                             uint32_t startRange,
+                                             uint32_t endRange)
+{
+    if (startRange >= endRange) {
+        return JXL_PARALLEL_RET_SUCCESS;
+    }
+
+    Private *p = static_cast<SharedParallelRunner *>(runnerOpaque)->d.data();
+
+    const uint64_t range = endRange - startRange;
+    const size_t numThreads = std::min<uint64_t>(static_cast<uint64_t>(std::max(1, p->workerCount() + 1)), range);
+    if (init(jpegxlOpaque, numThreads) != JXL_PARALLEL_RET_SUCCESS) {
+        return JXL_PARALLEL_RET_RUNNER_ERROR;
+    }
+
+    Task task;
+    task.jpegxlOpaque = jpegxlOpaque;
+    task.func = func;
+    task.next.store(startRange, std::memory_order_relaxed);
+    task.end = endRange;
+    task.numThreads = numThreads;
+
+    if (numThreads > 1) {
+        p->mutex.lock();
+        p->tasks.append(&task);
+        p->workAvailable.wakeAll();
+        p->mutex.unlock();
+    }
+
+    task.work(0);
+
+    if (numThreads > 1) {
+        // nobody can join once it's off the list, then wait for the ones still on it
+        p->mutex.lock();
+        p->tasks.removeOne(&task);
+        while (task.helpers > 0) {
+            p->helpersDone.wait(&p->mutex);
+        }
+        p->mutex.unlock();
+    }
+
+    return JXL_PARALLEL_RET_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#ifndef SHAREDPARALLELRUNNER_H
+#define SHAREDPARALLELRUNNER_H
+
+#include <QScopedPointer>
+
+#include <jxl/parallel_runner.h>
+
+/*
+ * One process-wide pool of worker threads handed to every in-process
+ * libjxl encoder and decoder as their parallel runner. Each parallel-for
+ * from libjxl becomes a task, and an idle worker joins whichever task has
+ * the fewest helpers, so the cores get split across all images in flight
+ * instead of every job bringing its own thread pool.
+ *
+ * The calling thread always works on its own task too, so a task
+ * finishes even while every worker is busy elsewhere.
+ */
+class SharedParallelRunner
+{
+public:
+    SharedParallelRunner();
+    ~SharedParallelRunner();
+
+    SharedParallelRunner(const SharedParallelRunner &v) = delete;
+
+    static SharedParallelRunner *instance();
+
+    // threads are only ever added, the ones above the count just sleep
+    void setWorkerCount(int workers);
+    int workerCount() const;
+
+    static JxlParallelRetCode run(void *runnerOpaque,
+                                  void *jpegxlOpaque,
+                                  JxlParallelRunInit init,
+                                  JxlParallelRunFunction func,
+                                  uint32_t startRange,
+                                  uint32_t endRange);
+
+private:
+    struct Private;
+    const QScopedPointer<Private> d;
+};
+
+#endif // SHAREDPARALLELRUNNER_H
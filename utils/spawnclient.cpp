@@ -0,0 +1,121 @@
+#include "spawnclient.h"
+#include "spawnhelper.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+SpawnClient::SpawnClient(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SpawnClient::~SpawnClient()
+{
+    if (m_helper && m_helper->state() != QProcess::NotRunning) {
+        // closing stdin makes the helper kill whatever is left and leave
+        m_helper->disconnect(this);
+        m_helper->closeWriteChannel();
+        if (!m_helper->waitForFinished(1000)) {
+            m_helper->kill();
+            m_helper->waitForFinished(1000);
+        }
+    }
+}
+
+bool SpawnClient::isSupported()
+{
+#ifdef Q_OS_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SpawnClient::start()
+{
+    if (!isSupported()) {
+        return false;
+    }
+
+    m_helper = new QProcess(this);
+    m_helper->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    connect(m_helper, &QProcess::readyReadStandardOutput, this, &SpawnClient::readEvents);
+    connect(m_helper,
+            QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this,
+            [this](int exitCode, QProcess::ExitStatus exitStatus) {
+                Q_UNUSED(exitCode);
+                Q_UNUSED(exitStatus);
+                m_lost = true;
+                emit helperLost();
+            });
+
+    m_helper->start(QCoreApplication::applicationFilePath(), {QString(SpawnHelper::argument())});
+    if (!m_helper->waitForStarted()) {
+        m_lost = true;
+        return false;
+    }
+    return true;
+}
+
+bool SpawnClient::isRunning() const
+{
+    return m_helper && !m_lost && m_helper->state() == QProcess::Running;
+}
+
+int SpawnClient::spawn(const QString &program, const QStringList &args)
+{
+    const int id = ++m_nextId;
+
+    QJsonObject obj;
+    obj.insert("op", "spawn");
+    obj.insert("id", id);
+    obj.insert("program", program);
+    obj.insert("args", QJsonArray::fromStringList(args));
+    send(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+
+    return id;
+}
+
+void SpawnClient::kill(int id)
+{
+    QJsonObject obj;
+    obj.insert("op", "kill");
+    obj.insert("id", id);
+    send(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+}
+
+void SpawnClient::send(const QByteArray &line)
+{
+    if (isRunning()) {
+        m_helper->write(line + '\n');
+    }
+}
+
+void SpawnClient::readEvents()
+{
+    m_buffer.append(m_helper->readAllStandardOutput());
+
+    int newLine;
+    while ((newLine = m_buffer.indexOf('\n')) >= 0) {
+        const QJsonObject obj = QJsonDocument::fromJson(m_buffer.left(newLine)).object();
+        m_buffer.remove(0, newLine + 1);
+
+        const int id = obj.value("id").toInt();
+        const QString event = obj.value("event").toString();
+
+        if (event == "started") {
+            emit started(id, static_cast<qint64>(obj.value("pid").toDouble()));
+        } else if (event == "finished") {
+            emit finished(id,
+                          obj.value("exitCode").toInt(),
+                          obj.value("crashed").toBool(),
+                          QByteArray::fromBase64(obj.value("stderr").toString().toLatin1()),
+                          QByteArray::fromBase64(obj.value("stdout").toString().toLatin1()));
+        } else if (event == "error") {
+            emit failed(id, obj.value("message").toString());
+        }
+    }
+}
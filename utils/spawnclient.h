@@ -0,0 +1,48 @@
+#ifndef SPAWNCLIENT_H
+#define SPAWNCLIENT_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+/*
+ * Parent side of SpawnHelper. start() launches the helper once, after
+ * that spawn() only costs a line on a pipe no matter how big the app has
+ * grown. Events are delivered on the thread that owns the client.
+ *
+ * If the helper dies, every job it still had is reported through
+ * helperLost() and the client stays unusable for the rest of the batch.
+ */
+class SpawnClient : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SpawnClient(QObject *parent = nullptr);
+    ~SpawnClient();
+
+    static bool isSupported();
+
+    bool start();
+    bool isRunning() const;
+    int spawn(const QString &program, const QStringList &args);
+    void kill(int id);
+
+signals:
+    void started(int id, qint64 pid);
+    void finished(int id, int exitCode, bool crashed, const QByteArray &stdErr, const QByteArray &stdOut);
+    void failed(int id, const QString &message);
+    void helperLost();
+
+private:
+    void readEvents();
+    void send(const QByteArray &line);
+
+    QProcess *m_helper = nullptr;
+    QByteArray m_buffer;
+    int m_nextId = 0;
+    bool m_lost = false;
+};
+
+#endif // SPAWNCLIENT_H
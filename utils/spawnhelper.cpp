@@ -0,0 +1,316 @@
+#include "spawnhelper.h"
+
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char **environ;
+
+namespace
+{
+// SIGCHLD lands here so poll() wakes up when a child exits
+int s_sigPipe[2] = {-1, -1};
+
+void onSigChld(int)
+{
+    const int savedErrno = errno;
+    const char c = 0;
+    const ssize_t ret = ::write(s_sigPipe[1], &c, 1);
+    Q_UNUSED(ret);
+    errno = savedErrno;
+}
+
+void setFdFlags(int fd, bool nonBlock)
+{
+    ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+    if (nonBlock) {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+struct Child {
+    pid_t pid = 0;
+    int errFd = -1;
+    int outFd = -1;
+    QByteArray err;
+    QByteArray out;
+    bool exited = false;
+    int exitCode = 0;
+    bool crashed = false;
+};
+
+void sendLine(const QJsonObject &obj)
+{
+    const QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+    qsizetype written = 0;
+    while (written < line.size()) {
+        const ssize_t ret = ::write(STDOUT_FILENO, line.constData() + written, line.size() - written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        written += ret;
+    }
+}
+
+void sendError(int id, const QString &message)
+{
+    QJsonObject obj;
+    obj.insert("id", id);
+    obj.insert("event", "error");
+    obj.insert("message", message);
+    sendLine(obj);
+}
+
+// reads whatever is there, closes the fd once the child is done writing
+void drainFd(int &fd, QByteArray &buffer)
+{
+    if (fd < 0) {
+        return;
+    }
+    char buf[16384];
+    for (;;) {
+        const ssize_t ret = ::read(fd, buf, sizeof(buf));
+        if (ret > 0) {
+            buffer.append(buf, ret);
+        } else if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        } else {
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+    }
+}
+
+void spawnChild(int id, const QJsonObject &req, QMap<int, Child> &children)
+{
+    const QByteArray program = req.value("program").toString().toLocal8Bit();
+    const QJsonArray args = req.value("args").toArray();
+
+    std::vector<QByteArray> argStorage;
+    argStorage.push_back(program);
+    for (const QJsonValue &arg : args) {
+        argStorage.push_back(arg.toString().toLocal8Bit());
+    }
+    std::vector<char *> argv;
+    for (QByteArray &arg : argStorage) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    int errPipe[2];
+    int outPipe[2];
+    if (::pipe(errPipe) != 0) {
+        sendError(id, QString::fromLocal8Bit(std::strerror(errno)));
+        return;
+    }
+    if (::pipe(outPipe) != 0) {
+        ::close(errPipe[0]);
+        ::close(errPipe[1]);
+        sendError(id, QString::fromLocal8Bit(std::strerror(errno)));
+        return;
+    }
+    setFdFlags(errPipe[0], true);
+    setFdFlags(errPipe[1], false);
+    setFdFlags(outPipe[0], true);
+    setFdFlags(outPipe[1], false);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO);
+
+    // the helper ignores SIGPIPE, the encoders shouldn't inherit that
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid = 0;
+    const int rc = posix_spawnp(&pid, program.constData(), &actions, &attr, argv.data(), environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(errPipe[1]);
+    ::close(outPipe[1]);
+
+    if (rc != 0) {
+        ::close(errPipe[0]);
+        ::close(outPipe[0]);
+        sendError(id, QString::fromLocal8Bit(std::strerror(rc)));
+        return;
+    }
+
+    Child child;
+    child.pid = pid;
+    child.errFd = errPipe[0];
+    child.outFd = outPipe[0];
+    children.insert(id, child);
+
+    QJsonObject obj;
+    obj.insert("id", id);
+    obj.insert("event", "started");
+    obj.insert("pid", static_cast<double>(pid));
+    sendLine(obj);
+}
+
+void handleRequest(const QByteArray &line, QMap<int, Child> &children)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) {
+        return;
+    }
+    const QJsonObject req = doc.object();
+    const int id = req.value("id").toInt();
+    const QString op = req.value("op").toString();
+
+    if (op == "spawn") {
+        spawnChild(id, req, children);
+    } else if (op == "kill") {
+        const auto it = children.find(id);
+        if (it != children.end() && !it->exited) {
+            ::kill(it->pid, SIGKILL);
+        }
+    }
+}
+} // namespace
+#endif
+
+const char *SpawnHelper::argument()
+{
+    return "--spawn-helper";
+}
+
+int SpawnHelper::exec()
+{
+#ifndef Q_OS_UNIX
+    return 1;
+#else
+    if (::pipe(s_sigPipe) != 0) {
+        return 1;
+    }
+    setFdFlags(s_sigPipe[0], true);
+    setFdFlags(s_sigPipe[1], true);
+
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSigChld;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&sa.sa_mask);
+    ::sigaction(SIGCHLD, &sa, nullptr);
+    ::signal(SIGPIPE, SIG_IGN);
+
+    QMap<int, Child> children;
+    QByteArray input;
+    bool inputOpen = true;
+
+    while (inputOpen || !children.isEmpty()) {
+        std::vector<pollfd> fds;
+        fds.push_back({s_sigPipe[0], POLLIN, 0});
+        if (inputOpen) {
+            fds.push_back({STDIN_FILENO, POLLIN, 0});
+        }
+        for (const Child &child : qAsConst(children)) {
+            if (child.errFd >= 0) {
+                fds.push_back({child.errFd, POLLIN, 0});
+            }
+            if (child.outFd >= 0) {
+                fds.push_back({child.outFd, POLLIN, 0});
+            }
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        char buf[4096];
+        while (::read(s_sigPipe[0], buf, sizeof(buf)) > 0) {
+        }
+
+        int status = 0;
+        pid_t pid = 0;
+        while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+            for (Child &child : children) {
+                if (child.pid == pid) {
+                    child.exited = true;
+                    if (WIFEXITED(status)) {
+                        child.exitCode = WEXITSTATUS(status);
+                    } else {
+                        child.crashed = true;
+                        child.exitCode = 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+                    }
+                    break;
+                }
+            }
+        }
+
+        for (Child &child : children) {
+            drainFd(child.errFd, child.err);
+            drainFd(child.outFd, child.out);
+        }
+
+        if (inputOpen && fds.size() > 1 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            const ssize_t ret = ::read(STDIN_FILENO, buf, sizeof(buf));
+            if (ret > 0) {
+                input.append(buf, ret);
+                int newLine;
+                while ((newLine = input.indexOf('\n')) >= 0) {
+                    handleRequest(input.left(newLine), children);
+                    input.remove(0, newLine + 1);
+                }
+            } else if (ret == 0 || errno != EINTR) {
+                // parent is gone or done, nothing left to run for
+                inputOpen = false;
+                for (const Child &child : qAsConst(children)) {
+                    if (!child.exited) {
+                        ::kill(child.pid, SIGKILL);
+                    }
+                }
+            }
+        }
+
+        // a child is done once it exited and both pipes hit EOF
+        for (auto it = children.begin(); it != children.end();) {
+            if (it->exited && it->errFd < 0 && it->outFd < 0) {
+                QJsonObject obj;
+                obj.insert("id", it.key());
+                obj.insert("event", "finished");
+                obj.insert("exitCode", it->exitCode);
+                obj.insert("crashed", it->crashed);
+                obj.insert("stderr", QString::fromLatin1(it->err.toBase64()));
+                obj.insert("stdout", QString::fromLatin1(it->out.toBase64()));
+                sendLine(obj);
+                it = children.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    return 0;
+#endif
+}
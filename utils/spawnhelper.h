@@ -0,0 +1,27 @@
+#ifndef SPAWNHELPER_H
+#define SPAWNHELPER_H
+
+/*
+ * Body of the tiny launcher process (the app started with
+ * SpawnHelper::argument()). It starts cjxl/djxl/cjpegli/djpegli with
+ * posix_spawn on request, so the cost of starting a child no longer
+ * grows with the GUI's memory. SpawnClient is the other end of the pipe.
+ *
+ * Requests come in on stdin, one JSON object per line:
+ *   {"op":"spawn","id":1,"program":"cjxl","args":[...]}
+ *   {"op":"kill","id":1}
+ * and events go out on stdout the same way:
+ *   {"id":1,"event":"started","pid":1234}
+ *   {"id":1,"event":"finished","exitCode":0,"crashed":false,"stderr":"<base64>","stdout":"<base64>"}
+ *   {"id":1,"event":"error","message":"..."}
+ *
+ * Unix only, elsewhere exec() just fails and QProcess does the job.
+ */
+class SpawnHelper
+{
+public:
+    static const char *argument();
+    static int exec();
+};
+
+#endif // SPAWNHELPER_H
@@ -0,0 +1,81 @@
+#include "workerprotocol.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMapIterator>
+
+QByteArray WorkerJob::toLine() const
+{
+    QJsonObject opts;
+    QMapIterator<QString, QString> mit(options);
+    while (mit.hasNext()) {
+        mit.next();
+        opts.insert(mit.key(), mit.value());
+    }
+
+    QJsonObject obj;
+    obj.insert("id", id);
+    obj.insert("decode", decode);
+    obj.insert("threads", threads);
+    obj.insert("input", input);
+    obj.insert("output", output);
+    obj.insert("options", opts);
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool WorkerJob::fromLine(const QByteArray &line, WorkerJob &job)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) {
+        return false;
+    }
+    const QJsonObject obj = doc.object();
+
+    job.id = obj.value("id").toInt();
+    job.decode = obj.value("decode").toBool();
+    job.threads = obj.value("threads").toInt();
+    job.input = obj.value("input").toString();
+    job.output = obj.value("output").toString();
+    job.options.clear();
+    const QJsonObject opts = obj.value("options").toObject();
+    for (auto it = opts.constBegin(); it != opts.constEnd(); ++it) {
+        job.options.insert(it.key(), it.value().toString());
+    }
+    return !job.input.isEmpty() && !job.output.isEmpty();
+}
+
+QByteArray WorkerReply::toLine() const
+{
+    QJsonObject obj;
+    obj.insert("id", id);
+    obj.insert("exitCode", exitCode);
+    obj.insert("needsBinary", needsBinary);
+    obj.insert("log", log);
+    // JSON numbers are doubles, fine for byte counts and pixels
+    obj.insert("pixels", static_cast<double>(pixels));
+    obj.insert("outputBytes", static_cast<double>(outputBytes));
+    obj.insert("wallMs", static_cast<double>(wallMs));
+    obj.insert("peakRss", static_cast<double>(peakRss));
+    obj.insert("mps", mps);
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool WorkerReply::fromLine(const QByteArray &line, WorkerReply &reply)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(line);
+    if (!doc.isObject()) {
+        return false;
+    }
+    const QJsonObject obj = doc.object();
+
+    reply.id = obj.value("id").toInt();
+    reply.exitCode = obj.value("exitCode").toInt(1);
+    reply.needsBinary = obj.value("needsBinary").toBool();
+    reply.log = obj.value("log").toString();
+    reply.pixels = static_cast<qint64>(obj.value("pixels").toDouble());
+    reply.outputBytes = static_cast<qint64>(obj.value("outputBytes").toDouble());
+    reply.wallMs = static_cast<qint64>(obj.value("wallMs").toDouble());
+    reply.peakRss = static_cast<qint64>(obj.value("peakRss").toDouble());
+    reply.mps = obj.value("mps").toDouble();
+    return true;
+}
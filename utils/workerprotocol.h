@@ -0,0 +1,41 @@
+#ifndef WORKERPROTOCOL_H
+#define WORKERPROTOCOL_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+/*
+ * Messages between ConversionThread and the encoder worker processes,
+ * one compact JSON object per line over the worker's stdin/stdout.
+ */
+struct WorkerJob
+{
+    int id{0};
+    bool decode{false};
+    int threads{0};
+    QString input;
+    QString output;
+    QMap<QString, QString> options;
+
+    QByteArray toLine() const;
+    static bool fromLine(const QByteArray &line, WorkerJob &job);
+};
+
+struct WorkerReply
+{
+    int id{0};
+    int exitCode{1};
+    bool needsBinary{false};
+    QString log;
+    qint64 pixels{0};
+    qint64 outputBytes{0};
+    qint64 wallMs{0};
+    qint64 peakRss{0};
+    double mps{0.0};
+
+    QByteArray toLine() const;
+    static bool fromLine(const QByteArray &line, WorkerReply &reply);
+};
+
+#endif // WORKERPROTOCOL_H